@@ -34,6 +34,7 @@
 #include "renderTeX.h"
 #include "propertyTab.h"
 #include "hiliteItem.h"
+#include "selectionSession.h"
 
 #include <QtGui/QStackedWidget>
 #include <QtGui/QGraphicsScene>
@@ -69,7 +70,7 @@ void abstractTool::prevEditorTab() {
 
 
 abstractTool::abstractTool( pdfScene *Scene, toolBox *ToolBar, QStackedWidget *EditArea ):
-	editArea(EditArea), scene(Scene), toolBar(ToolBar), currentEditItem( NULL ) {
+	editArea(EditArea), scene(Scene), toolBar(ToolBar), currentEditItem( NULL ), selection( NULL ) {
 	  cntxMenu = new QMenu();
 	  hi = new hiliteItem();
 	  hi->setColor( QColor(0,0,0,100) );
@@ -96,19 +97,19 @@ abstractTool::abstractTool( pdfScene *Scene, toolBox *ToolBar, QStackedWidget *E
 	  connect( propertyEdit, SIGNAL( authorChanged() ), this, SLOT( updateAuthor() ) );  	
 	  connect( contentEdit, SIGNAL( textChanged() ), this, SLOT( updateContent() ) );
 	  editArea->addWidget( editor );
-	  renderer = new renderTeX;
+	  renderer = renderTeX::instance();
 
 	  QAction *delAct  = cntxMenu->addAction( "Delete" );
 	  QAction *proAct  = cntxMenu->addAction( "Properties...");
 	  connect( delAct, SIGNAL( triggered() ), this, SLOT( deleteCurrentAnnotation() ) );
 	  connect( proAct, SIGNAL( triggered() ), this, SLOT( editCurrentAnnotationProperties() ) );
-	  connect( renderer, SIGNAL( itemReady(int) ), this, SLOT( teXToolTipReady(int) ) );
 	}
 
 abstractTool::~abstractTool() {
   editArea->removeWidget( editor );
   toolBar->removeTool( this );
   if ( editor ) delete editor;
+  delete selection;
   delete hi;
 }
 
@@ -142,18 +143,20 @@ int abstractTool::getApproxWidth( QString text ) {
 void abstractTool::setTeXToolTip( abstractAnnotation *annot ) { 
   QString content = annot->getContent();
   if ( content.contains( "$" ) ) { 
+    // only the tools which have TeX tooltips listen to the (shared) renderer here,
+    // the ids of the other tools' items (e.g. inline TeX) never get into toolTipItems
+    if ( toolTipItems.isEmpty() ) connect( renderer, SIGNAL( itemReady(int) ), this, SLOT( teXToolTipReady(int) ), Qt::UniqueConnection );
     int id = renderer->addItem( content );
-    if ( id < int2annot.size() ) int2annot[id] = annot;
-    else { 
-      int2annot.resize( id + 10 );
-      int2annot[id] = annot;
-    }
+    toolTipItems.insert( id, annot );
     renderer->preRender( id, false, getApproxWidth( content ) );
   }
 }
 
 void abstractTool::teXToolTipReady( int annotID ) { 
-  int2annot[annotID]->setMyToolTip( renderer->render( annotID, false, 1.5 ) );
+  if ( ! toolTipItems.contains( annotID ) ) return; // the renderer is shared, so the item can belong to another tool
+  QPixmap pix = renderer->render( annotID, false, 1.5 );
+  if ( ! renderer->isRendered( annotID, false, 1.5 ) ) return; // itemReady comes again when it is rasterized
+  toolTipItems.take( annotID )->setMyToolTip( pix );
   renderer->deleteItem( annotID );
 }
 
@@ -220,15 +223,21 @@ bool abstractTool::handleEvent( viewEvent *ev ) {
       return true;
   } if ( ev->type() == viewEvent::VE_MOUSE_PRESS && ( ev->btnCaused() == Qt::RightButton ) ) { 
     hi->clear();
-    hi->setPos( scene->topLeftPage(scene->posToPage( ev->scenePos() ) ) );
+    delete selection;
+    selection = new selectionSession( scene, ev->scenePos() );
+    hi->setPos( scene->topLeftPage( selection->pageNum() ) );
     hi->show();
-    selectedText = "";
   } else if ( ev->type() == viewEvent::VE_MOUSE_RELEASE && (ev->btnCaused() == Qt::RightButton ) ) {
-    qDebug() << "Selected: " << selectedText;
-    QApplication::clipboard()->setText( selectedText, QClipboard::Selection );
+    if ( selection ) { 
+      QString selectedText = selection->text();
+      qDebug() << "Selected: " << selectedText;
+      QApplication::clipboard()->setText( selectedText, QClipboard::Selection );
+      delete selection;
+      selection = NULL;
+    }
   } else if ( ev->type() == viewEvent::VE_MOUSE_MOVE && (ev->btnState() & Qt::RightButton ) ) { 
-    hi->updateBBoxes( scene->selectText( ev->mousePressPos(), ev->scenePos() ) );
-    selectedText = scene->selectedText( ev->mousePressPos(), ev->scenePos() );
+    selectionDelta delta;
+    if ( selection && selection->extendTo( ev->scenePos(), &delta ) ) hi->applyDelta( delta );
   } else return false;
 }
 
@@ -240,6 +249,7 @@ abstractAnnotation::abstractAnnotation( abstractTool *tool ):
 	myTool( tool ), date( QDate::currentDate() ), time( QTime::currentTime() ), haveToolTip(false), showingToolTip(false), movable( true )
 {
   setAcceptsHoverEvents( true );
+  setFlag( QGraphicsItem::ItemSendsGeometryChanges );
   setAuthor( tool->getAuthor() );
   connect( this, SIGNAL(needKeyFocus(bool)), tool, SIGNAL(needKeyFocus(bool)) );
 }
@@ -248,6 +258,7 @@ abstractAnnotation::abstractAnnotation( abstractTool *tool, PoDoFo::PdfAnnotatio
 	myTool( tool ), haveToolTip( false ), showingToolTip( false ), movable( true )
 { 
   setAcceptsHoverEvents( true );
+  setFlag( QGraphicsItem::ItemSendsGeometryChanges );
   if ( annot ) { 
     setAuthor( pdfUtil::pdfStringToQ( annot->GetTitle() ) );
     setContent( pdfUtil::pdfStringToQ( annot->GetContents() ) );
@@ -259,6 +270,40 @@ abstractAnnotation::abstractAnnotation( abstractTool *tool, PoDoFo::PdfAnnotatio
   }
 }
 
+/* The qobject_cast fails while the pdfScene is being destroyed
+ * (its items are deleted from the QGraphicsScene destructor),
+ * when there is no index to remove from anymore */
+abstractAnnotation::~abstractAnnotation() { 
+  pdfScene *sc = qobject_cast<pdfScene*>( scene() );
+  if ( sc ) sc->removeFromAnnotationIndex( this );
+  foreach( int id, myTool->toolTipItems.keys( this ) ) { // a tooltip still being rendered
+    myTool->toolTipItems.remove( id );
+    myTool->renderer->deleteItem( id );
+  }
+}
+
+void abstractAnnotation::geometryChanged() { 
+  pdfScene *sc = qobject_cast<pdfScene*>( scene() );
+  if ( sc ) sc->updateAnnotationIndex( this );
+}
+
+QVariant abstractAnnotation::itemChange( GraphicsItemChange change, const QVariant &value ) { 
+  pdfScene *sc;
+  switch( change ) { 
+	  case ItemSceneChange: // still in the old scene
+		  if ( ( sc = qobject_cast<pdfScene*>( scene() ) ) ) sc->removeFromAnnotationIndex( this );
+		  break;
+	  case ItemSceneHasChanged:
+	  case ItemParentHasChanged:
+	  case ItemPositionHasChanged:
+	  case ItemTransformHasChanged:
+		  geometryChanged();
+		  break;
+	  default:
+		  break;
+  }
+  return QGraphicsObject::itemChange( change, value );
+}
 
 void abstractAnnotation::setMyToolTip(const QPixmap &pixMap) {
   setAcceptsHoverEvents(true);
@@ -323,8 +368,10 @@ void abstractAnnotation::hideToolTip() {
 }
 
 void abstractAnnotation::setIcon(const QPixmap &icn) {
-  if ( ! ( icn.rect() == icon.rect() ) ) prepareGeometryChange();
+  bool resized = ! ( icn.rect() == icon.rect() );
+  if ( resized ) prepareGeometryChange();
   icon = icn;
+  if ( resized ) geometryChanged();
   update( icon.rect() );
 }
 
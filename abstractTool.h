@@ -16,6 +16,7 @@
 #include <QtCore/QString>
 #include <QtCore/QDate>
 #include <QtCore/QTime>
+#include <QtCore/QHash>
 
 #include <QtGui/QPixmap>
 #include <QtGui/QGraphicsItem>
@@ -47,6 +48,7 @@ namespace PoDoFo {
 
 class pdfCoords;
 class hiliteItem;
+class selectionSession;
 
 class abstractTool : public QObject { 
   Q_OBJECT
@@ -55,9 +57,9 @@ class abstractTool : public QObject {
 		QString author;
 
 		renderTeX *renderer;
-		QVector<abstractAnnotation *> int2annot;
+		QHash<int, abstractAnnotation *> toolTipItems; // renderer id -> the annotation waiting for its TeX tooltip
 		hiliteItem *hi;
-		QString selectedText;
+		selectionSession *selection; // the right-drag selection, the text is only extracted on release
 
 	protected:
 		QStackedWidget *editArea;
@@ -123,6 +125,10 @@ class abstractTool : public QObject {
 		 /* Returns the context menu for the item *it */
 		 virtual QMenu *contextMenu( QGraphicsItem *it );
 
+		 /* Called by the scene before the annotations are saved into
+		  * document (see abstractAnnotation::saveToPdfPage) */
+		 virtual void beginSave( PoDoFo::PdfDocument *document ) {};
+
 	public slots:
 		 virtual void hideEditor();
 		 
@@ -133,6 +139,16 @@ class abstractTool : public QObject {
 
 };
 
+/* The QGraphicsItem::type() of the annotations, so that the view
+ * and the tools can classify the items under the mouse (using
+ * qgraphicsitem_cast) without RTTI */
+enum annotationType { 
+  textAnnotationType = QGraphicsItem::UserType + 1,
+  hilightAnnotationType,
+  inlineTextAnnotationType,
+  linkAnnotationType
+};
+
 class abstractAnnotation : public QGraphicsObject { 
   Q_OBJECT
 	private:
@@ -155,6 +171,11 @@ class abstractAnnotation : public QGraphicsObject {
 		bool havePixmapTooltip() const { return (tp == pixmap); };
 		
 
+		/* Must be called after the bounding rectangle (or shape) changes
+		 * so that the scene can update its annotation index */
+		void geometryChanged();
+		virtual QVariant itemChange( GraphicsItemChange change, const QVariant &value );
+
 		void saveInfo2PDF( PoDoFo::PdfAnnotation *annot );
 		abstractAnnotation( abstractTool *tool, PoDoFo::PdfAnnotation *annot, pdfCoords *transform );
 	        friend class abstractTool;
@@ -167,6 +188,7 @@ class abstractAnnotation : public QGraphicsObject {
  
 	public:
 		abstractAnnotation( abstractTool *tool );
+		virtual ~abstractAnnotation();
 
 
 		bool showToolTip( const QPoint &scPos );
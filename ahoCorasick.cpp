@@ -0,0 +1,123 @@
+/**  This file is part of project comment
+ *
+ *  File: ahoCorasick.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "ahoCorasick.h"
+
+#include <QtCore/QQueue>
+
+ahoCorasick::ahoCorasick( const QStringList &Terms, Qt::CaseSensitivity CS ):
+	cs(CS)
+{
+  state root;
+  root.fail = 0;
+  states.append( root );
+  foreach( QString t, Terms ) { 
+    if ( t == "" ) continue;
+    QString p = ( cs == Qt::CaseInsensitive ) ? t.toCaseFolded() : t;
+    int st = 0;
+    for( int i = 0; i < p.size(); ++i ) st = addTransition( st, p[i].unicode() );
+    states[st].out.append( terms.size() );
+    terms.append( t );
+    patterns.append( p );
+  }
+  buildFailLinks();
+}
+
+/* Returns the target of the goto function from @st on @ch
+ * or -1 if there is none (binary search on the sorted transitions) */
+int ahoCorasick::go( int st, ushort ch ) const { 
+  const QVector<transition> &next = states[st].next;
+  int min = 0, max = next.size()-1, pivot;
+  while( min <= max ) { 
+    pivot = min+(max-min)/2;
+    if ( next[pivot].ch < ch ) min = pivot+1;
+    else if ( ch < next[pivot].ch ) max = pivot-1;
+    else return next[pivot].target;
+  }
+  return -1;
+}
+
+int ahoCorasick::addTransition( int st, ushort ch ) { 
+  int target = go( st, ch );
+  if ( target >= 0 ) return target;
+  state ns;
+  ns.fail = 0;
+  states.append( ns );
+  target = states.size()-1;
+  transition tr;
+  tr.ch = ch;
+  tr.target = target;
+  QVector<transition> &next = states[st].next;
+  int i = 0;
+  while( i < next.size() && next[i].ch < ch ) i++;
+  next.insert( i, tr );
+  return target;
+}
+
+/* Standard BFS construction of the failure function. The output
+ * sets of the fail targets are merged into each state, so that
+ * scan() need not walk the fail chain when reporting matches. */
+void ahoCorasick::buildFailLinks() { 
+  QQueue<int> queue;
+  foreach( transition tr, states[0].next ) { 
+    states[tr.target].fail = 0;
+    queue.enqueue( tr.target );
+  }
+  while( ! queue.isEmpty() ) { 
+    int st = queue.dequeue();
+    for( int i = 0; i < states[st].next.size(); ++i ) { 
+      transition tr = states[st].next[i];
+      int f = states[st].fail, target;
+      while( (target = go( f, tr.ch )) < 0 && f != 0 ) f = states[f].fail;
+      if ( target < 0 || target == tr.target ) target = 0;
+      states[tr.target].fail = target;
+      states[tr.target].out += states[target].out;
+      queue.enqueue( tr.target );
+    }
+  }
+}
+
+QList<ahoCorasick::match> ahoCorasick::scan( const QString &text ) const { 
+  QList<match> ret;
+  QVector<int> nextAllowed( terms.size(), 0 );
+  const QChar *data = text.unicode();
+  int st = 0, target, sz = text.size();
+  match m;
+  for( int i = 0; i < sz; ++i ) { 
+    ushort ch = data[i].unicode();
+    while( (target = go( st, ch )) < 0 && st != 0 ) st = states[st].fail;
+    st = ( target < 0 ) ? 0 : target;
+    foreach( int t, states[st].out ) { 
+      m.pos = i - patterns[t].size() + 1;
+      if ( m.pos < nextAllowed[t] ) continue;
+      m.term = t;
+      ret.append( m );
+      nextAllowed[t] = i+1;
+    }
+  }
+  return ret;
+}
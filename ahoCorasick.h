@@ -0,0 +1,85 @@
+#ifndef _ahoCorasick_H
+#define _ahoCorasick_H
+
+/**  This file is part of comment
+*
+*  File: ahoCorasick.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QVector>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+/* ahoCorasick --- a keyword automaton which finds all occurences
+ *                 of a (possibly large) set of terms in a single
+ *                 pass through the text. The automaton is built
+ *                 once in the constructor and can then be used to
+ *                 scan any number of texts (e.g. one per page).
+ */
+class ahoCorasick { 
+	public:
+		struct match { 
+		  int term; // index into the list of terms
+		  int pos;  // position of the first character of the match
+		};
+
+	private:
+		struct transition { 
+		  ushort ch;
+		  int target;
+		};
+		struct state { 
+		  QVector<transition> next; // sorted by ch
+		  int fail;
+		  QVector<int> out; // terms ending in this state (including those reachable via fail links)
+		};
+
+		QVector<state> states;
+		QStringList terms, patterns; // patterns are the case folded terms if cs == Qt::CaseInsensitive
+		Qt::CaseSensitivity cs;
+
+		int go( int st, ushort ch ) const;
+		int addTransition( int st, ushort ch );
+		void buildFailLinks();
+
+	public:
+		ahoCorasick( const QStringList &terms, Qt::CaseSensitivity cs = Qt::CaseSensitive );
+
+		int numOfTerms() const { return terms.size(); };
+		QString term( int i ) const { return terms[i]; };
+		int termLength( int i ) const { return patterns[i].size(); };
+		Qt::CaseSensitivity caseSensitivity() const { return cs; };
+
+		/* Returns all matches in @text ordered by their end position.
+		 * Overlapping matches of the same term are skipped, so
+		 * that the result agrees with repeated QString::indexOf calls.
+		 *
+		 * Note: If the automaton is case insensitive, @text is
+		 * expected to be already case folded (QString::toCaseFolded) */
+		QList<match> scan( const QString &text ) const;
+};
+
+
+
+#endif /* _ahoCorasick_H */
@@ -0,0 +1,124 @@
+/**  This file is part of project comment
+ *
+ *  File: annotationIndex.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "annotationIndex.h"
+#include "abstractTool.h"
+
+#include <QtCore/QtAlgorithms>
+
+#include <math.h>
+
+annotationIndex::annotationIndex( qreal size ):
+	cellSize( size ), nextSeq( 0 )
+{
+}
+
+QRect annotationIndex::cellRange( const QRectF &r ) const { 
+  int left = (int) floor( r.left() / cellSize ), top = (int) floor( r.top() / cellSize );
+  int right = (int) floor( r.right() / cellSize ), bottom = (int) floor( r.bottom() / cellSize );
+  return QRect( QPoint( left, top ), QPoint( right, bottom ) );
+}
+
+void annotationIndex::insert( abstractAnnotation *annot, const QMap<int, QRectF> &pageRects ) { 
+  int seq = nextSeq;
+  if ( entries.contains( annot ) ) { 
+    seq = entries[annot].seq;
+    remove( annot );
+  } else nextSeq++;
+  entry e;
+  e.seq = seq;
+  QMap<int, QRectF>::const_iterator it;
+  for( it = pageRects.constBegin(); it != pageRects.constEnd(); ++it ) { 
+    int page = it.key();
+    if ( page < 0 ) continue;
+    if ( page >= pages.size() ) pages.resize( page + 1 );
+    QRect cells = cellRange( it.value() );
+    QHash<int, QList<abstractAnnotation *> > &grid = pages[page];
+    for( int row = cells.top(); row <= cells.bottom(); ++row )
+      for( int col = cells.left(); col <= cells.right(); ++col )
+        grid[cellKey( col, row )].append( annot );
+    e.cells.insert( page, cells );
+  }
+  if ( ! e.cells.isEmpty() ) entries.insert( annot, e );
+}
+
+void annotationIndex::remove( abstractAnnotation *annot ) { 
+  QHash<abstractAnnotation *, entry>::iterator it = entries.find( annot );
+  if ( it == entries.end() ) return;
+  QHash<int, QList<abstractAnnotation *> >::iterator cell;
+  QMap<int, QRect>::const_iterator pg;
+  for( pg = it->cells.constBegin(); pg != it->cells.constEnd(); ++pg ) { 
+    QHash<int, QList<abstractAnnotation *> > &grid = pages[pg.key()];
+    for( int row = pg->top(); row <= pg->bottom(); ++row )
+      for( int col = pg->left(); col <= pg->right(); ++col ) { 
+        cell = grid.find( cellKey( col, row ) );
+        if ( cell == grid.end() ) continue;
+        cell->removeOne( annot );
+        if ( cell->isEmpty() ) grid.erase( cell );
+      }
+  }
+  entries.erase( it );
+}
+
+void annotationIndex::clear() { 
+  pages.clear();
+  entries.clear();
+  nextSeq = 0;
+}
+
+namespace { 
+  struct hit { 
+    abstractAnnotation *annot;
+    qreal z;
+    int seq;
+    bool operator<( const hit &o ) const { 
+      if ( z != o.z ) return z > o.z;
+      return seq > o.seq;
+    }
+  };
+}
+
+QList<abstractAnnotation *> annotationIndex::at( int page, const QPointF &pagePos, const QPointF &scenePos ) const { 
+  QList<abstractAnnotation *> ret;
+  if ( page < 0 || page >= pages.size() ) return ret;
+  QHash<int, QList<abstractAnnotation *> >::const_iterator cell = pages[page].find( 
+      cellKey( (int) floor( pagePos.x() / cellSize ), (int) floor( pagePos.y() / cellSize ) ) );
+  if ( cell == pages[page].end() ) return ret;
+  QList<hit> hits;
+  hit h;
+  foreach( abstractAnnotation *a, *cell ) { 
+    if ( ! a->isVisible() ) continue;
+    if ( ! a->contains( a->mapFromScene( scenePos ) ) ) continue; // the annotation's parent can be another page
+    h.annot = a;
+    h.z = a->zValue();
+    h.seq = entries.value( a ).seq;
+    hits.append( h );
+  }
+  qSort( hits );
+  foreach( h, hits ) ret.append( h.annot );
+  return ret;
+}
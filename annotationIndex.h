@@ -0,0 +1,87 @@
+#ifndef _annotationIndex_H
+#define _annotationIndex_H
+
+/**  This file is part of comment
+*
+*  File: annotationIndex.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QHash>
+#include <QtCore/QMap>
+#include <QtCore/QList>
+#include <QtCore/QVector>
+#include <QtCore/QRect>
+#include <QtCore/QRectF>
+#include <QtCore/QPointF>
+
+class abstractAnnotation;
+
+/* annotationIndex --- a uniform grid over each page, every cell
+ *                     holding the annotations whose bounding rectangle
+ *                     (in page coordinates) intersects it. Hit-testing
+ *                     a point is then a hash lookup of a single cell
+ *                     followed by an exact test of the (few) annotations
+ *                     in it, independent of the number of annotations
+ *                     on the page or of the items in the scene. An
+ *                     annotation reaching over several pages (e.g. a
+ *                     hilight of a selection spanning a page break) is
+ *                     in the grid of each of them.
+ *
+ *                     The index does not track the annotations itself,
+ *                     it must be told when they move (see pdfScene::updateAnnotationIndex).
+ */
+class annotationIndex { 
+	private:
+		struct entry { 
+		  QMap<int, QRect> cells; // page -> the cells covered on it
+		  int seq; // insertion order, later annotations are on top of earlier ones (at the same z-value)
+		};
+
+		qreal cellSize;
+		int nextSeq;
+		QVector< QHash<int, QList<abstractAnnotation *> > > pages;
+		QHash<abstractAnnotation *, entry> entries;
+
+		QRect cellRange( const QRectF &pageRect ) const;
+		static int cellKey( int col, int row ) { return ( row << 16 ) | ( col & 0xffff ); };
+
+	public:
+		annotationIndex( qreal cellSize = 64 );
+
+		/* Inserts @annot into the index (or moves it, if it is already there),
+		 * @pageRects maps each page the annotation covers to its bounding
+		 * rectangle in the coordinates of that page */
+		void insert( abstractAnnotation *annot, const QMap<int, QRectF> &pageRects );
+		void remove( abstractAnnotation *annot );
+		void clear();
+
+		bool contains( abstractAnnotation *annot ) const { return entries.contains( annot ); };
+		int size() const { return entries.size(); };
+
+		/* Returns the visible annotations on page @page whose shape contains
+		 * @scenePos, the topmost first. @pagePos is @scenePos in the
+		 * coordinates of the page. */
+		QList<abstractAnnotation *> at( int page, const QPointF &pagePos, const QPointF &scenePos ) const;
+};
+
+#endif /* _annotationIndex_H */
@@ -0,0 +1,108 @@
+/**  This file is part of project comment
+ *
+ *  File: benchTeXFormat.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+/* Measures the latency of compiling a snippet (the same way
+ * renderItem does) without and with the precompiled preamble
+ * format (see teXFormat) and with the prestarted workers (see
+ * teXWorker). The snippets are made unique so that they are not
+ * served from the teXCache.
+ *
+ * Usage: benchTeXFormat [count]
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEventLoop>
+#include <QtCore/QDateTime>
+#include <QtCore/QTime>
+#include <QtCore/QDebug>
+
+#include "teXjob.h"
+#include "teXFormat.h"
+#include "teXCache.h"
+#include "teXWorker.h"
+#include "config.h"
+
+#include <stdio.h>
+
+static const QString preamble = "\\usepackage{amsmath}\n\\usepackage{amsthm}\n";
+
+/* Compiles @count snippets one after another, returns the total time in ms */
+int compileSnippets( int count, const QString &tag ) { 
+  QTime timer;
+  timer.start();
+  for( int i = 0; i < count; ++i ) { 
+    compileJob job;
+    QEventLoop loop;
+    QObject::connect( &job, SIGNAL( finished(QString,QList<QRectF>,bool) ), &loop, SLOT( quit() ) );
+    QString src = "$\\sum_{k=1}^{"+QString::number( i )+"} k^2$ % "+tag;
+    job.start( renderItem::getLaTeX( src, preamble, 50 ) );
+    if ( job.running() ) loop.exec();
+  }
+  return timer.elapsed();
+}
+
+int main( int argc, char **argv ) { 
+  QCoreApplication app( argc, argv );
+  int count = 20;
+  if ( argc > 1 ) count = QString( argv[1] ).toInt();
+  if ( count < 1 ) { 
+    qWarning() << "Usage: "<< argv[0] << "[count]";
+    return -1;
+  }
+  if ( ! config().haveTeX() ) { 
+    qWarning() << "No TeX installation configured";
+    return -1;
+  }
+  QString tag = QString::number( QDateTime::currentDateTime().toTime_t() );
+  QString latexPath = config()["tex"], src = renderItem::getLaTeX( "", preamble, 50 );
+
+  printf( "# %d snippets, engine: %s\n", count, teXCache::engineVersion( latexPath ).toLocal8Bit().data() );
+  printf( "# mode\tsnippets\ttotal [ms]\tper snippet [ms]\n" );
+
+  teXWorkerPool::instance()->setEnabled( false );
+  teXFormat::instance()->setEnabled( false );
+  int plain = compileSnippets( count, tag+"p" );
+  printf( "plain\t%d\t%d\t%.1f\n", count, plain, (double) plain/count );
+
+  teXFormat::instance()->setEnabled( true );
+  QTime timer;
+  timer.start();
+  QString fmt = teXFormat::instance()->waitForFormat( src, latexPath );
+  if ( fmt == "" ) { 
+    qWarning() << "Could not build the format (is mylatexformat installed?)";
+    return -1;
+  }
+  printf( "# format %s built in %d ms\n", fmt.toLocal8Bit().data(), timer.elapsed() );
+  int withFmt = compileSnippets( count, tag+"f" );
+  printf( "format\t%d\t%d\t%.1f\n", count, withFmt, (double) withFmt/count );
+
+  teXWorkerPool::instance()->setEnabled( true );
+  int withWorker = compileSnippets( count, tag+"w" ); // the first snippet starts the first worker
+  printf( "worker\t%d\t%d\t%.1f\n", count, withWorker, (double) withWorker/count );
+  printf( "# speedup: format %.2f, worker %.2f\n", withFmt ? (double) plain/withFmt : 0.0, withWorker ? (double) plain/withWorker : 0.0 );
+  return 0;
+}
@@ -0,0 +1,270 @@
+/**  This file is part of project comment
+ *
+ *  File: benchTeXRender.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+/* Measures the TeX rendering pipeline on a corpus of snippets
+ * (inline maths, matrices, long paragraphs):
+ *
+ *   stage rows: the latency of the stages of rendering one snippet,
+ *               i.e. waiting in the compileScheduler queue, latex,
+ *               the bounding boxes (see compileJob), loading the pdf
+ *               with Poppler, rasterizing the bounding box (see
+ *               renderItem::rasterize) and the mipmaps (see renderTeX)
+ *
+ *   pass rows:  the throughput of renderTeX (batching, the scheduler
+ *               and the rasterization) for each given number of jobs,
+ *               with an empty teXCache (cold), a filled one (warm) and
+ *               from the pixmap cache (pixmap)
+ *
+ * The snippets are made unique so that the cold passes are not served
+ * from the teXCache. The output is tab separated, the lines starting
+ * with # are comments. The stages need no display. The pass rows need
+ * one for the pixmaps (e.g. run it under xvfb-run); without a display
+ * they are skipped.
+ *
+ * Usage: benchTeXRender [repeat] [jobs ...]
+ */
+
+#include <QtCore/QDateTime>
+#include <QtCore/QTime>
+#include <QtCore/QTimer>
+#include <QtCore/QEventLoop>
+#include <QtCore/QSet>
+#include <QtCore/QDebug>
+#include <QtGui/QApplication>
+#include <QtGui/QPixmap>
+
+#include "teXjob.h"
+#include "teXCache.h"
+#include "renderTeX.h"
+#include "compileScheduler.h"
+#include "config.h"
+
+#include <poppler-qt4.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const QString preamble = "\\usepackage{amsmath}\n\\usepackage{amssymb}\n";
+static const int passTimeout = 300*1000; // ms
+
+struct snippet {
+  const char *kind;
+  const char *source;
+};
+
+static const struct snippet corpus[] = {
+  { "inline", "$a^2+b^2=c^2$" },
+  { "inline", "$\\sum_{k=1}^{n} k^2 = \\frac{n(n+1)(2n+1)}{6}$" },
+  { "inline", "$\\int_0^\\infty e^{-x^2}\\,dx = \\frac{\\sqrt{\\pi}}{2}$" },
+  { "inline", "$\\lim_{n\\to\\infty} \\left(1+\\frac{1}{n}\\right)^n = e$" },
+  { "matrix", "$\\begin{pmatrix} a_{11} & a_{12} & a_{13} \\\\ a_{21} & a_{22} & a_{23} \\\\ a_{31} & a_{32} & a_{33} \\end{pmatrix}$" },
+  { "matrix", "$\\det\\begin{vmatrix} \\lambda-1 & 2 & 0 \\\\ 0 & \\lambda & -1 \\\\ 3 & 0 & \\lambda+2 \\end{vmatrix} = 0$" },
+  { "matrix", "\\[ A = \\left[\\begin{array}{cccc} 1 & 0 & \\cdots & 0 \\\\ 0 & 1 & \\cdots & 0 \\\\ \\vdots & & \\ddots & \\vdots \\\\ 0 & 0 & \\cdots & 1 \\end{array}\\right] \\]" },
+  { "paragraph", "Let $G$ be a finite group and $H \\leq G$ a subgroup. By Lagrange's theorem $|H|$ divides $|G|$, "
+                 "hence the order of every element $g \\in G$ divides $|G|$ and $g^{|G|} = e$. Applying this to the "
+                 "multiplicative group $(\\mathbb{Z}/p\\mathbb{Z})^*$ of order $p-1$ gives Fermat's little theorem, "
+                 "$a^{p-1} \\equiv 1 \\pmod p$ for every $a$ not divisible by the prime $p$." },
+  { "paragraph", "\\textbf{Proof.} Suppose $\\sqrt{2} = p/q$ with $p, q$ coprime. Then $p^2 = 2q^2$, so $p$ is even, "
+                 "$p = 2r$ and $q^2 = 2r^2$, so $q$ is even as well, a contradiction. \\begin{align*} "
+                 "(x+y)^2 &= x^2 + 2xy + y^2 \\\\ &\\geq 4xy \\end{align*} with equality iff $x = y$." },
+};
+static const int corpusSize = sizeof( corpus )/sizeof( struct snippet );
+
+/* Waits for the finished signal of a compileJob */
+class jobWaiter : public QObject {
+  Q_OBJECT
+	public:
+		QEventLoop loop;
+		QString pdf;
+		QList<QRectF> bBoxes;
+		bool status;
+
+	public slots:
+		void finished( QString resultPath, QList<QRectF> boxes, bool ok ) { 
+		  pdf = resultPath;
+		  bBoxes = boxes;
+		  status = ok;
+		  loop.quit();
+		}
+};
+
+/* Waits until all the items of a renderTeX are rendered */
+class renderWaiter : public QObject {
+  Q_OBJECT
+	public:
+		renderTeX *renderer;
+		qreal zoom;
+		int total;
+		QSet<int> done;
+		QEventLoop loop;
+
+	public slots:
+		void itemReady( int item ) { 
+		  renderer->render( item, false, zoom );
+		  if ( ! renderer->isRendered( item, false, zoom ) ) return; // itemReady comes again when it is rasterized
+		  done.insert( item );
+		  if ( done.size() == total ) loop.quit();
+		}
+};
+
+struct stage { 
+  const char *name;
+  QList<int> ms;
+};
+
+enum { QUEUE, LATEX, BBOX, LOAD, RASTERIZE, MIPMAPS, STAGES };
+
+QString snippetSource( int i, const QString &tag ) { 
+  return QString( corpus[i % corpusSize].source )+" % "+tag+QString::number( i );
+}
+
+void printStage( const QString &kind, struct stage &st ) { 
+  if ( st.ms.isEmpty() ) return;
+  qSort( st.ms );
+  qint64 sum = 0;
+  foreach( int ms, st.ms ) sum += ms;
+  int n = st.ms.size();
+  printf( "stage\t%s\t%s\t%d\t%d\t%d\t%.1f\n", kind.toLocal8Bit().data(), st.name, n, st.ms[(n-1)*50/100], st.ms[(n-1)*95/100], (double) sum/n );
+}
+
+/* Renders each snippet on its own, stage by stage */
+void measureStages( int repeat, const QString &tag ) { 
+  printf( "# kind\tstage\tsnippets\tp50 [ms]\tp95 [ms]\tmean [ms]\n" );
+  QStringList kinds;
+  for( int i = 0; i < corpusSize; ++i ) if ( ! kinds.contains( corpus[i].kind ) ) kinds.append( corpus[i].kind );
+  int failures = 0;
+  foreach( QString kind, kinds ) { 
+    struct stage stages[STAGES] = { { "queue" }, { "latex" }, { "bbox" }, { "load" }, { "rasterize" }, { "mipmaps" } };
+    for( int i = 0; i < corpusSize*repeat; ++i ) { 
+      if ( kind != corpus[i % corpusSize].kind ) continue;
+      compileJob job;
+      jobWaiter waiter;
+      QObject::connect( &job, SIGNAL( finished(QString,QList<QRectF>,bool) ), &waiter, SLOT( finished(QString,QList<QRectF>,bool) ) );
+      waiter.status = false;
+      job.start( renderItem::getLaTeX( snippetSource( i, tag+"s" ), preamble, 50 ) );
+      if ( job.running() ) waiter.loop.exec();
+      if ( ! waiter.status || waiter.bBoxes.isEmpty() ) { 
+        failures++;
+        continue;
+      }
+      stages[QUEUE].ms.append( job.queueTime() );
+      stages[LATEX].ms.append( job.latexTime() );
+      stages[BBOX].ms.append( job.bboxTime() );
+
+      QTime timer;
+      timer.start();
+      Poppler::Document *pdf = Poppler::Document::load( waiter.pdf );
+      stages[LOAD].ms.append( timer.restart() );
+      delete pdf;
+      timer.restart();
+      QImage img = renderItem::rasterize( waiter.pdf, 0, waiter.bBoxes[0], 4 );
+      stages[RASTERIZE].ms.append( timer.restart() );
+      renderTeX::mipmaps( img );
+      stages[MIPMAPS].ms.append( timer.elapsed() );
+    }
+    for( int s = 0; s < STAGES; ++s ) printStage( kind, stages[s] );
+  }
+  if ( failures ) printf( "# %d snippets failed to compile\n", failures );
+}
+
+/* Renders the whole corpus through a new renderTeX, returns its total time in ms */
+int renderPass( renderTeX *renderer, const QString &tag, int repeat, int &rendered ) { 
+  renderWaiter waiter;
+  waiter.renderer = renderer;
+  waiter.zoom = 1.5;
+  waiter.total = corpusSize*repeat;
+  QObject::connect( renderer, SIGNAL( itemReady(int) ), &waiter, SLOT( itemReady(int) ) );
+  QTimer::singleShot( passTimeout, &waiter.loop, SLOT( quit() ) );
+  QTime timer;
+  timer.start();
+  for( int i = 0; i < corpusSize*repeat; ++i ) renderer->preRender( renderer->addItem( snippetSource( i, tag ), preamble ) );
+  waiter.loop.exec();
+  rendered = waiter.done.size();
+  return timer.elapsed();
+}
+
+void printPass( const char *pass, int jobs, int snippets, int rendered, int ms, renderTeX *renderer ) { 
+  printf( "pass\t%s\t%d\t%d\t%d\t%d\t%.1f\t%d\t%d\n", pass, jobs, snippets, rendered, ms, ms ? 1000.0*rendered/ms : 0.0, renderer->cacheHits(), renderer->cacheMisses() );
+}
+
+/* The throughput of renderTeX for @jobs parallel compilations */
+void measurePasses( int repeat, int jobs, const QString &tag ) { 
+  int snippets = corpusSize*repeat, rendered;
+  compileScheduler::instance()->setMaxJobs( jobs );
+  QString passTag = tag+"j"+QString::number( jobs );
+
+  renderTeX cold;
+  int ms = renderPass( &cold, passTag, repeat, rendered );
+  printPass( "cold", jobs, snippets, rendered, ms, &cold );
+
+  renderTeX warm; // the same sources, so the compilations are served from the teXCache
+  ms = renderPass( &warm, passTag, repeat, rendered );
+  printPass( "warm", jobs, snippets, rendered, ms, &warm );
+
+  // the items of warm are rendered, so all of these are served from its pixmap cache
+  warm.resetCacheStats();
+  QTime timer;
+  timer.start();
+  rendered = 0;
+  for( int i = 0; i < snippets; ++i ) { 
+    warm.render( i, false, 1.5 );
+    if ( warm.isRendered( i, false, 1.5 ) ) rendered++;
+  }
+  printPass( "pixmap", jobs, snippets, rendered, timer.elapsed(), &warm );
+}
+
+int main( int argc, char **argv ) { 
+  bool gui = getenv( "DISPLAY" ) != NULL; // pixmaps need a display
+  QApplication app( argc, argv, gui );
+  int repeat = 1;
+  if ( argc > 1 ) repeat = QString( argv[1] ).toInt();
+  QList<int> jobs;
+  for( int i = 2; i < argc; ++i ) jobs.append( QString( argv[i] ).toInt() );
+  if ( jobs.isEmpty() ) jobs << 1 << 2 << 4;
+  if ( repeat < 1 || jobs.contains( 0 ) ) { 
+    qWarning() << "Usage: "<< argv[0] << "[repeat] [jobs ...]";
+    return -1;
+  }
+  if ( ! config().haveTeX() ) { 
+    qWarning() << "No TeX installation configured";
+    return -1;
+  }
+  QString tag = QString::number( QDateTime::currentDateTime().toTime_t() );
+
+  printf( "# %d snippets x %d, engine: %s\n", corpusSize, repeat, teXCache::engineVersion( config()["tex"] ).toLocal8Bit().data() );
+  measureStages( repeat, tag );
+
+  if ( ! gui ) { 
+    printf( "# no display, skipping the renderTeX passes\n" );
+    return 0;
+  }
+  printf( "# pass\tjobs\tsnippets\trendered\ttotal [ms]\tsnippets/s\tpixmap hits\tpixmap misses\n" );
+  foreach( int j, jobs ) measurePasses( repeat, j, tag );
+  return 0;
+}
+
+#include "benchTeXRender.moc"
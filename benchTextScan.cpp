@@ -0,0 +1,120 @@
+/**  This file is part of project comment
+ *
+ *  File: benchTextScan.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+/* Compares textScan::indexOf against QString::indexOf on the text
+ * extracted from a real pdf (built the same way as in pageTextLayer).
+ *
+ * Usage: benchTextScan file.pdf [word ...]
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QTime>
+#include <QtCore/QDebug>
+
+#include <poppler-qt4.h>
+
+#include "textScan.h"
+
+#include <stdio.h>
+
+static const int rounds = 20;
+
+int countQt( const QStringList &pages, const QString &word, Qt::CaseSensitivity cs ) { 
+  int count = 0, pos;
+  foreach( QString text, pages ) { 
+    pos = text.indexOf( word, 0, cs );
+    while( pos >= 0 ) { 
+      count++;
+      pos = text.indexOf( word, pos+word.size(), cs );
+    }
+  }
+  return count;
+}
+
+int countScan( const QStringList &pages, QString word, Qt::CaseSensitivity cs ) { 
+  int count = 0, pos;
+  if ( cs == Qt::CaseInsensitive ) word = word.toCaseFolded();
+  foreach( QString text, pages ) { 
+    pos = textScan::indexOf( text, word );
+    while( pos >= 0 ) { 
+      count++;
+      pos = textScan::indexOf( text, word, pos+word.size() );
+    }
+  }
+  return count;
+}
+
+int main( int argc, char **argv ) { 
+  QCoreApplication app( argc, argv );
+  if ( argc < 2 ) { 
+    qWarning() << "Usage: "<< argv[0] << "file.pdf [word ...]";
+    return -1;
+  }
+  Poppler::Document *pdf = Poppler::Document::load( argv[1] );
+  if ( ! pdf ) { 
+    qWarning() << "Cannot load" << argv[1];
+    return -1;
+  }
+  QStringList pages, folded, words;
+  int chars = 0;
+  for( int i = 0; i < pdf->numPages(); ++i ) { 
+    Poppler::Page *pg = pdf->page( i );
+    QString text;
+    foreach( Poppler::TextBox *box, pg->textList() ) { 
+      text += " " + box->text();
+      delete box;
+    }
+    delete pg;
+    pages.append( text );
+    folded.append( text.toCaseFolded() );
+    chars += text.size();
+  }
+  delete pdf;
+  for( int i = 2; i < argc; ++i ) words.append( QString::fromLocal8Bit( argv[i] ) );
+  if ( words.isEmpty() ) words << "the" << "and" << "Theorem" << "xylophone" << "a";
+
+  printf( "# %d pages, %d characters, %d rounds, textScan implementation: %s\n", pages.size(), chars, rounds, textScan::implementation() );
+  printf( "# word\tcase\tmatches\tQString::indexOf [ms]\ttextScan [ms]\tspeedup\n" );
+  QTime timer;
+  for( int c = 0; c < 2; ++c ) { 
+    Qt::CaseSensitivity cs = ( c == 0 ) ? Qt::CaseSensitive : Qt::CaseInsensitive;
+    const QStringList &hay = ( c == 0 ) ? pages : folded;
+    foreach( QString word, words ) { 
+      int qtCount = 0, scanCount = 0;
+      timer.start();
+      for( int r = 0; r < rounds; ++r ) qtCount = countQt( pages, word, cs );
+      int qtTime = timer.elapsed();
+      timer.start();
+      for( int r = 0; r < rounds; ++r ) scanCount = countScan( hay, word, cs );
+      int scanTime = timer.elapsed();
+      if ( qtCount != scanCount ) qWarning() << "Match count mismatch for" << word << ":" << qtCount << "!=" << scanCount;
+      printf( "%s\t%s\t%d\t%d\t%d\t%.2f\n", word.toLocal8Bit().data(), ( c == 0 ) ? "exact" : "folded",
+	      scanCount, qtTime, scanTime, scanTime ? (double) qtTime/scanTime : 0.0 );
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+/**  This file is part of project comment
+ *
+ *  File: compileScheduler.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "compileScheduler.h"
+#include "teXjob.h"
+#include "config.h"
+
+#include <QtCore/QThread>
+#include <QtCore/QDebug>
+
+compileScheduler::compileScheduler() { 
+  max = qMax( 1, QThread::idealThreadCount() );
+  if ( config().haveKey( "tex_jobs" ) && config()["tex_jobs"].toInt() > 0 ) max = config()["tex_jobs"].toInt();
+}
+
+compileScheduler *compileScheduler::instance() { 
+  static compileScheduler *scheduler = new compileScheduler;
+  return scheduler;
+}
+
+void compileScheduler::setMaxJobs( int n ) { 
+  max = qMax( 1, n );
+  startJobs();
+}
+
+compileJob *compileScheduler::runningWithSource( const QString &source ) const { 
+  foreach( compileJob *job, running ) if ( job->source == source ) return job;
+  return NULL;
+}
+
+void compileScheduler::startJobs() { 
+  compileJob *job;
+  while( running.size() < max && ! queue.isEmpty() ) { 
+    job = queue.takeFirst();
+    if ( runningWithSource( job->source ) ) { // the same source is being compiled, wait for its result
+      waiting.insert( job->source, job );
+      continue;
+    }
+    running.insert( job );
+    job->launch();
+  }
+  emit queueChanged( queueDepth(), running.size() );
+}
+
+void compileScheduler::submit( compileJob *job ) { 
+  if ( ! running.contains( job ) && ! queue.contains( job ) && waiting.key( job ).isNull() ) queue.append( job );
+  startJobs();
+}
+
+void compileScheduler::prioritize( compileJob *job ) { 
+  int i = queue.indexOf( job );
+  if ( i > 0 ) queue.move( i, 0 );
+}
+
+void compileScheduler::cancel( compileJob *job ) { 
+  QString source = waiting.key( job );
+  if ( queue.removeAll( job ) || ( ! source.isNull() && waiting.remove( source, job ) ) ) 
+    emit queueChanged( queueDepth(), running.size() );
+}
+
+void compileScheduler::jobDone( compileJob *job ) { 
+  if ( ! running.remove( job ) ) return;
+  // the jobs waiting for the source go first, they will find it in the teXCache (or compile it, if the job failed)
+  QList<compileJob *> waiters = waiting.values( job->source );
+  waiting.remove( job->source );
+  foreach( compileJob *w, waiters ) queue.prepend( w );
+  startJobs();
+}
+
+#include "compileScheduler.moc"
@@ -0,0 +1,82 @@
+#ifndef _compileScheduler_H
+#define _compileScheduler_H
+
+/**  This file is part of comment
+*
+*  File: compileScheduler.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QObject>
+#include <QtCore/QList>
+#include <QtCore/QSet>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+
+class compileJob;
+
+/* compileScheduler --- all the compileJobs (of all the renderTeX
+ *                      instances) go through this scheduler, which
+ *                      runs at most maxJobs() of them at once (by default
+ *                      one per core) and queues the rest. A job is queued
+ *                      at most once (restarting a queued job just replaces
+ *                      its source, see compileJob) and jobs which somebody
+ *                      is waiting for or which are in view can be moved
+ *                      to the front of the queue by prioritize. A job
+ *                      whose source is being compiled by a running job
+ *                      waits for it and then takes the result from the
+ *                      teXCache instead of compiling the source again.
+ */
+class compileScheduler : public QObject { 
+  Q_OBJECT
+	private:
+		QList<compileJob *> queue;
+		QSet<compileJob *> running;
+		QMultiHash<QString, compileJob *> waiting; // source -> the jobs waiting for the running job compiling it
+		int max;
+
+		compileScheduler();
+		void startJobs();
+		compileJob *runningWithSource( const QString &source ) const;
+
+	public:
+		static compileScheduler *instance();
+
+		/* The maximal number of concurrently running jobs, can
+		 * be set by the tex_jobs configuration key */
+		int maxJobs() const { return max; };
+		void setMaxJobs( int n );
+
+		int queueDepth() const { return queue.size() + waiting.size(); };
+		int numRunning() const { return running.size(); };
+
+		/* Called by the compileJobs */
+		void submit( compileJob *job );
+		void prioritize( compileJob *job );
+		void cancel( compileJob *job );
+		void jobDone( compileJob *job );
+
+	signals:
+		void queueChanged( int queued, int running );
+};
+
+#endif /* _compileScheduler_H */
@@ -74,7 +74,7 @@ configurator::configurator()
 {
   fName = QDir::homePath()+"/.comment";
   load();
-  haveTeXAndFriends = findTeX() && findGhostScript();
+  haveTeXAndFriends = findTeX(); // ghostscript is not needed since compileJob computes the bounding boxes itself
   qDebug() << "initializing configurator";
 }
 
@@ -110,3 +110,11 @@ QString &configurator::operator[] (const QString key) {
   return cfg[key.toLower().replace(' ','_')];
 }
 
+QString configurator::cacheDir( const QString subDir ) { 
+  QString path = cfg.value( "cache_dir" );
+  if ( path == "" ) path = QDir::homePath()+"/.comment_cache";
+  if ( subDir != "" ) path += "/"+subDir;
+  if ( ! QDir().mkpath( path ) ) qWarning() << "Cannot create cache directory" << path;
+  return path;
+}
+
@@ -54,6 +54,12 @@ class configurator {
 		void removeKey(const QString key );
 
 		QString &operator[] (const QString key);
+
+		/* Returns the path to the directory @subDir of the
+		 * cache directory (creating it if necessary). The cache
+		 * directory defaults to ~/.comment_cache and can be
+		 * changed by the cache_dir key */
+		QString cacheDir( const QString subDir = "" );
 		
 };
 
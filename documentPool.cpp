@@ -0,0 +1,115 @@
+/**  This file is part of project comment
+ *
+ *  File: documentPool.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "documentPool.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QThread>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QDebug>
+
+#include <poppler-qt4.h>
+
+#include <stdlib.h>
+
+documentPool::documentPool( const QByteArray &pdfData, int size ):
+	data( pdfData )
+{
+  Poppler::Document *doc;
+  for( int i = 0; i < size; ++i ) { 
+    if ( ! ( doc = Poppler::Document::loadFromData( data ) ) ) break;
+    doc->setRenderHint( Poppler::Document::TextAntialiasing, true );
+    doc->setRenderHint( Poppler::Document::Antialiasing, true );
+    docs.append( doc );
+    leased.append( false );
+    lastPage.append( -1 );
+  }
+}
+
+documentPool::~documentPool() { 
+  QMutexLocker lock( &mutex );
+  for( int i = 0; i < leased.size(); ++i )
+    if ( leased[i] ) qWarning() << "documentPool: destroyed while document" << i << "is still leased";
+  foreach( Poppler::Document *doc, docs ) delete doc;
+}
+
+documentPool *documentPool::load( const QString &fileName, int size ) { 
+  QFile f( fileName );
+  if ( ! f.open( QIODevice::ReadOnly ) ) return NULL;
+  if ( size < 1 ) size = qMax( 1, QThread::idealThreadCount() );
+  documentPool *ret = new documentPool( f.readAll(), size );
+  if ( ret->size() == 0 ) { 
+    delete ret;
+    return NULL;
+  }
+  return ret;
+}
+
+Poppler::Document *documentPool::acquire( int page ) { 
+  QMutexLocker lock( &mutex );
+  int best;
+  while( true ) { 
+    best = -1;
+    for( int i = 0; i < docs.size(); ++i ) { 
+      if ( leased[i] ) continue;
+      if ( best < 0 || page < 0 ) best = i;
+      else if ( lastPage[i] >= 0 && ( lastPage[best] < 0 || abs( lastPage[i] - page ) < abs( lastPage[best] - page ) ) ) best = i;
+      if ( page < 0 || lastPage[best] == page ) break;
+    }
+    if ( best >= 0 ) break;
+    released.wait( &mutex );
+  }
+  leased[best] = true;
+  if ( page >= 0 ) lastPage[best] = page;
+  return docs[best];
+}
+
+void documentPool::release( Poppler::Document *doc ) { 
+  QMutexLocker lock( &mutex );
+  int i = docs.indexOf( doc );
+  if ( i < 0 || ! leased[i] ) { 
+    qWarning() << "documentPool::release: the document was not leased from this pool";
+    return;
+  }
+  leased[i] = false;
+  released.wakeOne();
+}
+
+documentLease::documentLease( documentPool *Pool, int page ):
+	pool( Pool ), pg( page )
+{
+  doc = pool->acquire( page );
+}
+
+documentLease::~documentLease() { 
+  pool->release( doc );
+}
+
+Poppler::Page *documentLease::page( int page ) { 
+  if ( page < 0 ) page = pg;
+  return doc->page( page );
+}
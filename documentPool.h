@@ -0,0 +1,96 @@
+#ifndef _documentPool_H
+#define _documentPool_H
+
+/**  This file is part of comment
+*
+*  File: documentPool.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+namespace Poppler { 
+  class Document;
+  class Page;
+}
+
+/* documentPool --- Poppler::Document may not be used from several threads
+ *                  at once, so the pool opens several independent
+ *                  documents over the same (in-memory) pdf data and
+ *                  leases them to the worker threads. Each document
+ *                  remembers the page it last worked on and a lease
+ *                  for a page prefers the document which worked on
+ *                  the nearest page, to keep Poppler's caches warm.
+ */
+class documentPool { 
+	private:
+		QByteArray data;
+		QVector<Poppler::Document *> docs;
+		QVector<bool> leased;
+		QVector<int> lastPage;
+		QMutex mutex;
+		QWaitCondition released;
+
+		documentPool( const QByteArray &pdfData, int size );
+
+	public:
+		~documentPool();
+
+		/* Opens @size documents (by default one per core) over the
+		 * contents of @fileName. Returns NULL if the file cannot be read
+		 * or Poppler cannot open it. */
+		static documentPool *load( const QString &fileName, int size = -1 );
+
+		int size() const { return docs.size(); };
+
+		/* Leases a document for working on page @page (-1 if the page does
+		 * not matter), waiting until one is available. Each acquire must be
+		 * paired with a release, see also documentLease. */
+		Poppler::Document *acquire( int page = -1 );
+		void release( Poppler::Document *doc );
+};
+
+/* documentLease --- leases a document from the pool for the
+ *                   lifetime of the object */
+class documentLease { 
+	private:
+		documentPool *pool;
+		Poppler::Document *doc;
+		int pg;
+
+	public:
+		documentLease( documentPool *Pool, int page = -1 );
+		~documentLease();
+
+		Poppler::Document *document() { return doc; };
+
+		/* Returns a new Poppler::Page (owned by the caller) of the
+		 * leased document, @page defaults to the page the lease was
+		 * taken for. The page must not outlive the lease. */
+		Poppler::Page *page( int page = -1 );
+};
+
+#endif /* _documentPool_H */
@@ -0,0 +1,139 @@
+/**  This file is part of project comment
+ *
+ *  File: fuzzySearch.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "fuzzySearch.h"
+
+#include <string.h>
+
+fuzzyMatcher::fuzzyMatcher( const QString &Pattern, int maxErrors, Qt::CaseSensitivity CS ):
+	pattern( Pattern ), k( maxErrors ), cs( CS )
+{
+  if ( cs == Qt::CaseInsensitive ) pattern = pattern.toCaseFolded();
+  if ( k < 0 ) k = 0;
+  if ( k >= pattern.size() ) k = pattern.size()-1; // otherwise every position would match
+  memset( peq, 0, sizeof(peq) );
+  memset( rpeq, 0, sizeof(rpeq) );
+  if ( ! isValid() ) return;
+  int m = pattern.size();
+  for( int i = 0; i < m; ++i ) { 
+    ushort ch = pattern[i].unicode(), rch = pattern[m-1-i].unicode();
+    if ( ch < 256 ) peq[ch] |= ( Q_UINT64_C(1) << i );
+    else peqHigh[ch] |= ( Q_UINT64_C(1) << i );
+    if ( rch < 256 ) rpeq[rch] |= ( Q_UINT64_C(1) << i );
+    else rpeqHigh[rch] |= ( Q_UINT64_C(1) << i );
+  }
+}
+
+bool fuzzyMatcher::isValid() const { 
+  return pattern.size() > 0 && pattern.size() <= maxPatternLength;
+}
+
+ushort fuzzyMatcher::charAt( const QString &text, int i ) const { 
+  if ( cs == Qt::CaseInsensitive ) return text[i].toCaseFolded().unicode();
+  return text[i].unicode();
+}
+
+quint64 fuzzyMatcher::mask( const quint64 *low, const QHash<ushort, quint64> &high, ushort ch ) const { 
+  if ( ch < 256 ) return low[ch];
+  return high.value( ch, 0 );
+}
+
+/* Given that an approximate match ends at @end, finds where it starts:
+ * runs the (global) Myers recurrence for the reversed pattern backwards
+ * from @end and returns the start giving the smallest distance */
+int fuzzyMatcher::findStart( const QString &text, int end, int *distance ) const { 
+  int m = pattern.size();
+  quint64 high = Q_UINT64_C(1) << (m-1);
+  quint64 Pv = ~Q_UINT64_C(0), Mv = 0, Eq, Xv, Xh, Ph, Mh;
+  int score = m, best = m+1, bestStart = end-m+1;
+  for( int j = end; j >= 0 && j > end-m-k; --j ) { 
+    Eq = mask( rpeq, rpeqHigh, charAt( text, j ) );
+    Xv = Eq | Mv;
+    Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+    Ph = Mv | ~(Xh | Pv);
+    Mh = Pv & Xh;
+    if ( Ph & high ) score++;
+    else if ( Mh & high ) score--;
+    Ph = (Ph << 1) | 1;
+    Mh <<= 1;
+    Pv = Mh | ~(Xv | Ph);
+    Mv = Ph & Xv;
+    if ( score < best ) { 
+      best = score;
+      bestStart = j;
+    }
+  }
+  *distance = best;
+  return bestStart;
+}
+
+/* Appends the match ending at @end to @matches. If it overlaps
+ * the previous match, only the one with smaller distance is kept */
+void fuzzyMatcher::addMatch( QList<match> &matches, const QString &text, int end ) const { 
+  match mt;
+  mt.pos = findStart( text, end, &mt.distance );
+  mt.length = end - mt.pos + 1;
+  while( ! matches.isEmpty() && matches.last().pos + matches.last().length > mt.pos ) { 
+    if ( mt.distance >= matches.last().distance ) return;
+    matches.removeLast();
+  }
+  matches.append( mt );
+}
+
+QList<fuzzyMatcher::match> fuzzyMatcher::scan( const QString &text ) const { 
+  QList<match> ret;
+  if ( ! isValid() ) return ret;
+  int m = pattern.size(), n = text.size();
+  quint64 high = Q_UINT64_C(1) << (m-1);
+  quint64 Pv = ~Q_UINT64_C(0), Mv = 0, Eq, Xv, Xh, Ph, Mh;
+  int score = m, bestEnd = -1, bestScore = k+1;
+  for( int j = 0; j < n; ++j ) { 
+    Eq = mask( peq, peqHigh, charAt( text, j ) );
+    Xv = Eq | Mv;
+    Xh = (((Eq & Pv) + Pv) ^ Pv) | Eq;
+    Ph = Mv | ~(Xh | Pv);
+    Mh = Pv & Xh;
+    if ( Ph & high ) score++;
+    else if ( Mh & high ) score--;
+    Ph <<= 1;
+    Mh <<= 1;
+    Pv = Mh | ~(Xv | Ph);
+    Mv = Ph & Xv;
+    // A run of nearby end positions belongs to the same match, keep the best one
+    if ( bestEnd >= 0 && j - bestEnd >= m ) { 
+      addMatch( ret, text, bestEnd );
+      bestEnd = -1;
+      bestScore = k+1;
+    }
+    if ( score < bestScore ) { 
+      bestScore = score;
+      bestEnd = j;
+    }
+  }
+  if ( bestEnd >= 0 ) addMatch( ret, text, bestEnd );
+  return ret;
+}
@@ -0,0 +1,76 @@
+#ifndef _fuzzySearch_H
+#define _fuzzySearch_H
+
+/**  This file is part of comment
+*
+*  File: fuzzySearch.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QString>
+#include <QtCore/QList>
+#include <QtCore/QHash>
+
+/* fuzzyMatcher --- approximate search of a pattern (at most 64 characters)
+ *                  with at most maxErrors edits (insertions, deletions or
+ *                  substitutions), using Myers' bit-parallel algorithm.
+ *                  Useful for OCR'd documents where e.g. 'rn' is read as 'm'.
+ *
+ *                  The matcher is immutable once constructed, so a single
+ *                  instance may be used from several threads at once.
+ */
+class fuzzyMatcher { 
+	public:
+		struct match { 
+		  int pos, length;
+		  int distance; // the edit distance of text[pos,pos+length) from the pattern
+		};
+
+		static const int maxPatternLength = 64;
+
+	private:
+		QString pattern;
+		int k;
+		Qt::CaseSensitivity cs;
+		quint64 peq[256], rpeq[256];               // match masks of the pattern and the reversed pattern
+		QHash<ushort, quint64> peqHigh, rpeqHigh; // characters >= 256
+
+		inline ushort charAt( const QString &text, int i ) const;
+		inline quint64 mask( const quint64 *low, const QHash<ushort, quint64> &high, ushort ch ) const;
+		int findStart( const QString &text, int end, int *distance ) const;
+		void addMatch( QList<match> &matches, const QString &text, int end ) const;
+
+	public:
+		fuzzyMatcher( const QString &pattern, int maxErrors, Qt::CaseSensitivity cs = Qt::CaseInsensitive );
+
+		/* false if the pattern is empty or too long */
+		bool isValid() const;
+		int maxErrors() const { return k; };
+
+		/* Returns the non-overlapping approximate matches of the
+		 * pattern in @text ordered by position. Of overlapping
+		 * candidates the one with the smallest distance is kept */
+		QList<match> scan( const QString &text ) const;
+};
+
+
+#endif /* _fuzzySearch_H */
@@ -31,8 +31,12 @@
 #include "pdfScene.h"
 #include "pdfUtil.h"
 #include "propertyTab.h"
+#include "selectionSession.h"
+#include "pdfPageItem.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QMap>
+#include <QtCore/QUuid>
 #include <QtGui/QIcon>
 #include <QtGui/QStackedWidget>
 #include <QtGui/QTextEdit>
@@ -47,13 +51,23 @@ QIcon hilightTool::icon;
 
 
 hilightTool::hilightTool( pdfScene *Scene, toolBox *ToolBar, QStackedWidget *EditArea):
-	abstractTool( Scene, ToolBar, EditArea ), editingHilight(false)
+	abstractTool( Scene, ToolBar, EditArea ), editingHilight(false), session(NULL), sessionAnnot(NULL)
 {
   icon = QIcon::fromTheme("format-text-underline");
   setToolName( "Hilight Tool" );
   toolBar->addTool( icon, this );
 }
 
+hilightTool::~hilightTool() { 
+  endSession();
+}
+
+void hilightTool::endSession() { 
+  delete session;
+  session = NULL;
+  sessionAnnot = NULL;
+}
+
 
 void hilightTool::newActionEvent( const QPointF *ScenePos ) {
   qDebug() << "New action event...";
@@ -67,13 +81,18 @@ void hilightTool::newActionEvent( const QPointF *ScenePos ) {
 void hilightTool::updateCurrentAnnotation( QPointF ScenePos ) { 
   hilightAnnotation *annot = dynamic_cast<hilightAnnotation*>(currentEditItem); 
   Q_ASSERT( annot );
-  QPointF from = annot->scenePos();
-  QPointF to = ScenePos;
-  annot->updateSelection( scene->selectText(  from, to ) );
+  if ( ! session || sessionAnnot != annot ) { // the selection is dragged from the annotation's position
+    endSession();
+    session = new selectionSession( scene, annot->scenePos() );
+    sessionAnnot = annot;
+    annot->updateSelection( QList<TextBox*>() );
+  }
+  selectionDelta delta;
+  if ( session->extendTo( ScenePos, &delta ) ) annot->applyDelta( delta );
 }
 
 bool hilightTool::acceptEventsFor( QGraphicsItem *item ) {  
-  return dynamic_cast<hilightAnnotation*>( item );
+  return qgraphicsitem_cast<hilightAnnotation*>( item );
 }
 
 void hilightTool::editItem( abstractAnnotation *item ) { 
@@ -87,6 +106,7 @@ void hilightTool::editItem( abstractAnnotation *item ) {
 }
 
 void hilightTool::editAnnotationExtent( abstractAnnotation *item ) { 
+   endSession();
    if ( currentEditItem == item ) { 
      currentEditItem = NULL;
      editArea->hide();
@@ -99,6 +119,7 @@ void hilightTool::editAnnotationExtent( abstractAnnotation *item ) {
 
 void hilightTool::editAnnotationText() { 
    editingHilight = false;
+   endSession();
    editArea->setCurrentWidget( editor );
    editArea->show();
    contentEdit->setText( currentEditItem->getContent() );
@@ -109,7 +130,7 @@ void hilightTool::editAnnotationText() {
 bool hilightTool::handleEvent( viewEvent *ev ) { 
   hilightAnnotation *annot;
   if ( ev->type() == viewEvent::VE_MOUSE_PRESS && ( ev->btnCaused() == Qt::LeftButton ) ) {
-    if ( annot = dynamic_cast<hilightAnnotation*>(ev->item()) ) { 
+    if ( annot = qgraphicsitem_cast<hilightAnnotation*>(ev->item()) ) { 
       editAnnotationExtent( annot );
     } else {
       QPointF pos = ev->scenePos();
@@ -155,6 +176,11 @@ void hilightAnnotation::paint( QPainter *painter, const QStyleOptionGraphicsItem
 
 
 QPainterPath hilightAnnotation::shape() const { 
+  if ( ! shapeValid ) { 
+    exactShape = QPainterPath();
+    foreach( QRectF box, hBoxes ) exactShape.addRect( box );
+    shapeValid = true;
+  }
   return exactShape;
 }
 
@@ -171,11 +197,25 @@ void hilightAnnotation::updateSelection( QList<TextBox*> newSelection ) {
   }
   bBox = tmp.boundingRect();
   exactShape=tmp;
+  shapeValid = true;
+  geometryChanged();
   update();
 }
 
+void hilightAnnotation::applyDelta( const selectionDelta &delta ) { 
+  QRectF changed = delta.apply( hBoxes, scenePos() ), newBBox;
+  foreach( QRectF box, hBoxes ) newBBox |= box;
+  shapeValid = false;
+  if ( newBBox != bBox ) { 
+    prepareGeometryChange();
+    bBox = newBBox;
+    geometryChanged();
+  }
+  update( changed );
+}
+
 hilightAnnotation::hilightAnnotation( hilightTool *tool, PoDoFo::PdfAnnotation *hilightAnnot, pdfCoords *transform): 
-	abstractAnnotation(tool, hilightAnnot, transform), bBox(0,0,0,0) {
+	abstractAnnotation(tool, hilightAnnot, transform), bBox(0,0,0,0), shapeValid(true) {
 	  movable=false;
 	  if ( isA( hilightAnnot ) ) {
 	    PoDoFo::PdfArray quadPoints = hilightAnnot->GetQuadPoints();
@@ -187,6 +227,9 @@ hilightAnnotation::hilightAnnotation( hilightTool *tool, PoDoFo::PdfAnnotation *
 	      exactShape.addRect( tmp );
 	    }
 	    bBox = exactShape.boundingRect();
+	    PoDoFo::PdfDictionary &dict = hilightAnnot->GetObject()->GetDictionary();
+	    if ( dict.HasKey( PoDoFo::PdfName( "comment_hilight_group" ) ) )
+	      group = pdfUtil::pdfStringToQ( dict.GetKey( PoDoFo::PdfName( "comment_hilight_group" ) )->GetString() );
 	  }
 	  setZValue( 9 );
 };
@@ -195,18 +238,53 @@ bool hilightAnnotation::isA( PoDoFo::PdfAnnotation *annotation ) {
   if ( ! annotation ) return false;
   return ( annotation->GetType() == PoDoFo::ePdfAnnotation_Highlight );
 }
+/* Splits the boxes by the page they lie on (the hilight belongs to
+ * the page it was started on, but a selection may run over to the following
+ * pages) and saves a linked Highlight annotation on each of the pages */
 void hilightAnnotation::saveToPdfPage( PoDoFo::PdfDocument *document, PoDoFo::PdfPage *pg, pdfCoords *coords ) { 
   qDebug() << "Saving HILIGHT annotation for "<<getAuthor()<<" : " << pos();
-  QList<QRectF> pageBoxes;
+  pdfScene *sc = qobject_cast<pdfScene*>( scene() );
+  pdfPageItem *parentPage = dynamic_cast<pdfPageItem*>( parentItem() );
+  if ( ! sc || ! parentPage ) { 
+    QList<QRectF> pageBoxes;
+    foreach( QRectF box, hBoxes ) pageBoxes.append( mapToParent(box).boundingRect() );
+    savePart( pg, coords, pageBoxes );
+    return;
+  }
+  QMap<int, QList<QRectF> > pageBoxes;
+  QRectF sceneBox;
+  int p;
   foreach( QRectF box, hBoxes ) { 
-    pageBoxes.append( mapToParent(box).boundingRect() );
+    sceneBox = mapToScene( box ).boundingRect();
+    p = sc->posToPage( sceneBox.center() );
+    pageBoxes[p].append( sceneBox.translated( -sc->topLeftPage( p ) ) );
   }
-  PoDoFo::PdfRect *brect = coords->sceneToPdf( mapToParent(bBox).boundingRect() );
+  if ( pageBoxes.size() > 1 && group.isEmpty() ) group = QUuid::createUuid().toString();
+  PoDoFo::PdfPage *page;
+  pdfCoords pageCoords;
+  QMap<int, QList<QRectF> >::const_iterator it;
+  for( it = pageBoxes.constBegin(); it != pageBoxes.constEnd(); ++it ) { 
+    if ( it.key() == parentPage->getPageNum() ) savePart( pg, coords, it.value() );
+    else { 
+      page = document->GetPage( it.key() );
+      pageCoords.setPage( page );
+      savePart( page, &pageCoords, it.value() );
+    }
+  }
+}
+
+/* @pageBoxes are in the coordinates of the page @pg */
+void hilightAnnotation::savePart( PoDoFo::PdfPage *pg, pdfCoords *coords, const QList<QRectF> &pageBoxes ) { 
+  QRectF bound;
+  foreach( QRectF box, pageBoxes ) bound |= box;
+  PoDoFo::PdfRect *brect = coords->sceneToPdf( bound );
   PoDoFo::PdfArray quadPoints =  pdfUtil::qBoxesToQuadPoints( pageBoxes, coords );
   PoDoFo::PdfAnnotation *annot = pg->CreateAnnotation( PoDoFo::ePdfAnnotation_Highlight, *brect );
   annot->SetQuadPoints( quadPoints );
   saveInfo2PDF( annot );
   annot->SetColor( 0, 0, 1, 0 ); // Set the annotation to be yellow
+  if ( ! group.isEmpty() ) 
+    annot->GetObject()->GetDictionary().AddKey( PoDoFo::PdfName( "comment_hilight_group" ), pdfUtil::qStringToPdf( group ) );
   delete brect;
 }
 
@@ -33,6 +33,8 @@
 
 class toolBox;
 class hilightAnnotation;
+class selectionSession;
+struct selectionDelta;
 
 namespace Poppler { 
   class TextBox;
@@ -44,6 +46,10 @@ class hilightTool : public abstractTool {
 	  static QIcon icon;
 	  bool editingHilight; // if true, mouse movement edits the extent
 	                       // of the current hilight
+	  selectionSession *session; // the selection being dragged out while editing the extent
+	  hilightAnnotation *sessionAnnot; // the annotation the session belongs to
+
+	  void endSession();
 
 	protected:
 	  void updateCurrentAnnotation( QPointF ScenePos );
@@ -52,6 +58,7 @@ class hilightTool : public abstractTool {
 
 	public:
 		hilightTool( pdfScene *Scene, toolBox *ToolBar, QStackedWidget *EditArea);
+		~hilightTool();
 
 		virtual abstractAnnotation *processAnnotation( PoDoFo::PdfAnnotation *annotation, pdfCoords *transform );
 		virtual void newActionEvent( const QPointF *scPos );
@@ -67,12 +74,25 @@ class hilightAnnotation : public abstractAnnotation {
 	private:
 		QList<QRectF> hBoxes;
 		QRectF bBox;
-		QPainterPath exactShape;
+		mutable QPainterPath exactShape; // rebuilt on demand after applyDelta
+		mutable bool shapeValid;
+		/* A hilight spanning several pages is saved as one Highlight
+		 * annotation per page, the parts share this id (stored under
+		 * the comment_hilight_group key). When loaded the parts stay
+		 * separate annotations, but keep the id. */
+		QString group;
+
+		void savePart( PoDoFo::PdfPage *pg, pdfCoords *coords, const QList<QRectF> &pageBoxes );
 	public:
+		enum { Type = hilightAnnotationType };
+		int type() const { return Type; };
+
 		hilightAnnotation( hilightTool *tool, PoDoFo::PdfAnnotation *hilightAnnot = NULL, pdfCoords *transform = NULL );
 		~hilightAnnotation() {};
 
 		void updateSelection( QList<Poppler::TextBox*> newSelection );
+		/* Changes the hilighted boxes by the change of a selection session */
+		void applyDelta( const selectionDelta &delta );
 
 		void paint( QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget );
 		QRectF boundingRect() const {return bBox;};
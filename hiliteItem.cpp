@@ -26,6 +26,7 @@
 
 
 #include "hiliteItem.h"
+#include "selectionSession.h"
 
 #include <QtCore/QDebug>
 
@@ -34,14 +35,14 @@
 using namespace Poppler;
 
 hiliteItem::hiliteItem( QPointF topLeftPage, QList<TextBox *> bboxes ):
-	col( 0, 255, 217, 100 ), bBox( 0, 0, 0, 0 ), active(false)
+	col( 0, 255, 217, 100 ), bBox( 0, 0, 0, 0 ), shapeValid(true), active(false)
 { 
   setPos( topLeftPage );
   updateBBoxes( bboxes );
 }
 
 hiliteItem::hiliteItem():
-	col( 0, 0, 0, 100), bBox( 0, 0, 0, 0 ), active(false)
+	col( 0, 0, 0, 100), bBox( 0, 0, 0, 0 ), shapeValid(true), active(false)
 {
   setPos( QPointF(0,0) );
   hide();
@@ -77,6 +78,11 @@ void hiliteItem::paint( QPainter *painter, const QStyleOptionGraphicsItem *optio
 }
 
 QPainterPath hiliteItem::shape() const { 
+  if ( ! shapeValid ) { 
+    exactShape = QPainterPath();
+    foreach( QRectF box, hBoxes ) exactShape.addRect( box );
+    shapeValid = true;
+  }
   return exactShape;
 }
 
@@ -88,6 +94,7 @@ void hiliteItem::clear() {
   hBoxes.clear();
   bBox = QRectF(0,0,0,0);
   exactShape = QPainterPath();
+  shapeValid = true;
   update();
 }
 
@@ -104,5 +111,17 @@ void hiliteItem::updateBBoxes( QList<TextBox*> bboxes ) {
   }
   bBox = tmp.boundingRect();
   exactShape=tmp;
+  shapeValid = true;
   update();
 }
+
+void hiliteItem::applyDelta( const selectionDelta &delta ) { 
+  QRectF changed = delta.apply( hBoxes, scenePos() ), newBBox;
+  foreach( QRectF box, hBoxes ) newBBox |= box;
+  if ( newBBox != bBox ) { 
+    prepareGeometryChange();
+    bBox = newBBox;
+  }
+  shapeValid = false;
+  update( changed );
+}
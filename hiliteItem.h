@@ -35,11 +35,14 @@ namespace Poppler {
   class TextBox;
 };
 
+struct selectionDelta;
+
 class hiliteItem : public QGraphicsItem {
 	private:
 		QList<QRectF> hBoxes;
 		QRectF bBox;
-		QPainterPath exactShape;
+		mutable QPainterPath exactShape; // rebuilt on demand after applyDelta
+		mutable bool shapeValid;
 		QColor col;
 		bool active;
 
@@ -48,6 +51,9 @@ class hiliteItem : public QGraphicsItem {
 		hiliteItem( QPointF topLeftPage, QList<Poppler::TextBox *> bboxes );
 
 		void updateBBoxes( QList<Poppler::TextBox*> bboxes );
+		/* Updates the boxes by the change of a selection session,
+		 * repainting only the changed part */
+		void applyDelta( const selectionDelta &delta );
 		void clear();
 
 		void setColor( QColor col );
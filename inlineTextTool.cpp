@@ -34,30 +34,34 @@
 #include "renderTeX.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtGui/QIcon>
 #include <QtGui/QStackedWidget>
 #include <QtGui/QTextEdit>
+#include <QtGui/QTextDocument>
 #include <QtGui/QTabWidget>
 #include <QtGui/QStyleOption>
 
 #include <poppler-qt4.h>
 
+#include <stdlib.h>
+
 using namespace Poppler;
 
 QIcon inlineTextTool::icon;
 
 inlineTextTool::inlineTextTool( pdfScene *Scene, toolBox *ToolBar, QStackedWidget *EditArea):
-	abstractTool( Scene, ToolBar, EditArea )
+	abstractTool( Scene, ToolBar, EditArea ), saveDocument( NULL ), snippetPdfs( 64 )
 {
   icon = QIcon::fromTheme("draw-text");
   setToolName( "Inline Text Tool" );
   toolBar->addTool( QIcon(icon), this );
-  inlineRenderer = new renderTeX();
+  inlineRenderer = renderTeX::instance();
   connect( inlineRenderer, SIGNAL(itemReady(int)), this, SLOT(teXReady(int)) );
 }
 
 inlineTextTool::~inlineTextTool() {
-  delete inlineRenderer;
 }
 
 
@@ -74,7 +78,7 @@ void inlineTextTool::newActionEvent( const QPointF *ScenePos ) {
 
 
 bool inlineTextTool::acceptEventsFor( QGraphicsItem *item ) {  
-  return dynamic_cast<inlineTextAnnotation*>( item );
+  return qgraphicsitem_cast<inlineTextAnnotation*>( item );
 }
 
 void inlineTextTool::editItem( abstractAnnotation *item ) { 
@@ -119,10 +123,21 @@ void inlineTextTool::prepareTeX( inlineTextAnnotation *ann ) {
   inlineRenderer->preRender( ann->inlineID );
 }
 
+void inlineTextTool::previewTeX( inlineTextAnnotation *ann ) { 
+  if ( ann != currentEditItem ) return;
+  QString text = ann->item->toPlainText();
+  if ( text.contains("$") ) inlineRenderer->previewItem( ann->inlineID, text );
+  else ann->setMyToolTip( text );
+}
+
 void inlineTextTool::teXReady( int item ) {
   qDebug() << " Rendering finished for " << item;
-  if ( (item < int2annot.size()) && (int2annot[item]) ) int2annot[item]->setTeXAppearance( true );
-  else qDebug() << " Item does not exist anymore ... ";
+  if ( (item < int2annot.size()) && (int2annot[item]) ) { 
+    if ( int2annot[item] == currentEditItem ) { // a typed preview
+      QPixmap pix = inlineRenderer->render( item, false, 1.5 );
+      if ( inlineRenderer->isRendered( item, false, 1.5 ) ) int2annot[item]->setMyToolTip( pix );
+    } else int2annot[item]->setTeXAppearance( true );
+  } else qDebug() << " Item does not exist anymore ... ";
 }
   
 /*bool inlineTextTool::handleEvent( viewEvent *ev ) { 
@@ -136,6 +151,84 @@ void inlineTextTool::teXReady( int item ) {
 }*/
 
 
+void inlineTextTool::beginSave( PoDoFo::PdfDocument *document ) { 
+  saveDocument = document;
+  appearances.clear();
+  importedPdfs.clear();
+}
+
+PoDoFo::PdfObject *inlineTextTool::importedPage( const QString &pdfKey, PoDoFo::PdfMemDocument *pdf, int page, PoDoFo::PdfDocument *document ) { 
+  if ( ! importedPdfs.contains( pdfKey ) ) { 
+    // the objects of pdf keep their order, shifted past the objects (and free numbers) of document
+    importedPdfs.insert( pdfKey, document->GetObjects()->GetSize()+document->GetObjects()->GetFreeObjects().size() );
+    document->Append( *pdf, false ); // false: the pages are not added to the page tree
+  }
+  PoDoFo::PdfReference src = pdf->GetPage( page )->GetObject()->Reference();
+  return document->GetObjects()->GetObject( PoDoFo::PdfReference( src.ObjectNumber()+importedPdfs[pdfKey], src.GenerationNumber() ) );
+}
+
+PoDoFo::PdfObject *inlineTextTool::appearanceFor( int item, PoDoFo::PdfDocument *document ) { 
+  if ( document != saveDocument ) beginSave( document );
+  QString pdfFile = inlineRenderer->getPDF( item );
+  int pdfPage = inlineRenderer->getPDFPage( item );
+  QString key = pdfFile+":"+QString::number( pdfPage );
+  if ( appearances.contains( key ) ) return appearances[key];
+
+  // a temporary file name can be reused for another snippet (the mtime
+  // does not tell, teXCache::lookup touches the cached pdfs)
+  QString version = pdfFile+":"+QString::number( QFileInfo( pdfFile ).size() );
+  PoDoFo::PdfMemDocument *pdfDoc = snippetPdfs.object( version );
+  if ( ! pdfDoc ) { 
+    pdfDoc = new PoDoFo::PdfMemDocument();
+    try { 
+      pdfDoc->Load( QFile::encodeName( pdfFile ).data() );
+    } catch ( PoDoFo::PdfError error ) { 
+      qWarning() << "Error loading the TeX rendering" << pdfFile << ":" << error.what();
+      delete pdfDoc;
+      return NULL;
+    }
+    snippetPdfs.insert( version, pdfDoc );
+  }
+  QRectF cropBox = inlineRenderer->getBBox( item );
+  qDebug() << "Appearance BBox (in QT): " << cropBox;
+  PoDoFo::PdfRect trim( cropBox.x(), cropBox.y(), cropBox.width(), cropBox.height() );
+  try { 
+    PoDoFo::PdfObject *page = importedPage( version, pdfDoc, pdfPage, document );
+    if ( ! page ) { 
+      qWarning() << "Error importing page" << pdfPage << "of the TeX rendering" << pdfFile;
+      return NULL;
+    }
+    // a form XObject with the contents and resources of the imported page
+    PoDoFo::PdfXObject annotAppearance( trim, document );
+    PoDoFo::PdfObject *appearance = annotAppearance.GetObject();
+    PoDoFo::PdfObject *resources = page->GetIndirectKey( PoDoFo::PdfName("Resources") );
+    if ( resources ) appearance->GetDictionary().AddKey( PoDoFo::PdfName("Resources"), *resources );
+    PoDoFo::PdfObject *contents = page->GetIndirectKey( PoDoFo::PdfName("Contents") );
+    QList<PoDoFo::PdfObject *> streams;
+    if ( contents && contents->IsArray() ) { 
+      PoDoFo::PdfArray &parts = contents->GetArray();
+      for( PoDoFo::PdfArray::iterator it = parts.begin(); it != parts.end(); ++it )
+        if ( it->IsReference() ) streams.append( document->GetObjects()->GetObject( it->GetReference() ) );
+    } else if ( contents ) streams.append( contents );
+    QByteArray data;
+    char *buf;
+    PoDoFo::pdf_long len;
+    foreach( PoDoFo::PdfObject *stream, streams ) { 
+      if ( ! stream || ! stream->HasStream() ) continue;
+      stream->GetStream()->GetFilteredCopy( &buf, &len );
+      data.append( buf, len );
+      data.append( '\n' );
+      free( buf );
+    }
+    appearance->GetStream()->Set( data.constData(), data.size() );
+    appearances.insert( key, appearance );
+    return appearance;
+  } catch ( PoDoFo::PdfError error ) { 
+    qWarning() << "Error importing the TeX rendering" << pdfFile << ":" << error.what();
+    return NULL;
+  }
+}
+
 abstractAnnotation *inlineTextTool::processAnnotation( PoDoFo::PdfAnnotation *annotation, pdfCoords *transform ) {
   if ( ! inlineTextAnnotation::isA( annotation ) ) return NULL;
   inlineTextAnnotation *ann = new inlineTextAnnotation( this, annotation, transform );
@@ -147,7 +240,10 @@ abstractAnnotation *inlineTextTool::processAnnotation( PoDoFo::PdfAnnotation *an
 
 
 void inlineTextAnnotation::setTeXAppearance( bool haveTeX ) {
-  if ( haveTeX == teXAppearance ) return;
+  if ( haveTeX == teXAppearance ) { 
+    if ( haveTeX ) update(); // a sharper rendering is available
+    return;
+  }
   prepareGeometryChange();
   teXAppearance=haveTeX;
   if ( haveTeX ) {
@@ -158,6 +254,7 @@ void inlineTextAnnotation::setTeXAppearance( bool haveTeX ) {
     item->hide();
   }
   else item->show();
+  geometryChanged();
 }
 
 void inlineTextAnnotation::paint( QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget ) {  
@@ -175,10 +272,19 @@ void inlineTextAnnotation::paint( QPainter *painter, const QStyleOptionGraphicsI
     option->exposedRect.getRect( &x, &y, &w, &h );
     qDebug() << "Painting pixmap";
     painter->drawPixmap( exposed, pix, QRectF( x*zoom,y*zoom,w*zoom,h*zoom ) );
-  } else item->paint( painter, option, widget );
+  } else {
+    // the TeX rendering of a visible annotation should not wait behind the hidden ones
+    dynamic_cast<inlineTextTool*>(myTool)->inlineRenderer->prioritize( inlineID );
+    item->paint( painter, option, widget );
+  }
   //painter->drawRect( item->boundingRect() );
 }
 
+void inlineTextAnnotation::textChanged() { 
+  geometryChanged();
+  dynamic_cast<inlineTextTool*>(myTool)->previewTeX( this );
+}
+
 QRectF inlineTextAnnotation::boundingRect() const {
   if ( teXAppearance ) {
     return brec;
@@ -195,18 +301,17 @@ QPainterPath inlineTextAnnotation::shape() const {
 }
 
 
-int inlineTextAnnotation::inlineAnnotationCount = 0;
-
 inlineTextAnnotation::inlineTextAnnotation( inlineTextTool *tool, PoDoFo::PdfAnnotation *inlineAnnot, pdfCoords *transform): 
 	abstractAnnotation(tool, inlineAnnot, transform), teXAppearance(false)
 {
-  inlineID = inlineAnnotationCount++;
+  inlineID = tool->inlineRenderer->addItem( "" );
   item = new QGraphicsTextItem();
   item->setTextInteractionFlags( Qt::TextEditable );
   item->setParentItem(this);
   item->setPos(0,0);
   item->setZValue( 8 );
   item->setPlainText(getContent());
+  connect( item->document(), SIGNAL( contentsChanged() ), this, SLOT( textChanged() ) );
   movable=true;
   setZValue( 9 );
 };
@@ -215,6 +320,7 @@ inlineTextAnnotation::~inlineTextAnnotation() {
   delete item;
   inlineTextTool *tl = dynamic_cast<inlineTextTool*>(myTool);
   tl->int2annot[inlineID]=NULL;
+  tl->inlineRenderer->deleteItem( inlineID );
 }
 
 bool inlineTextAnnotation::isA( PoDoFo::PdfAnnotation *annotation ) { 
@@ -229,17 +335,10 @@ void inlineTextAnnotation::saveToPdfPage( PoDoFo::PdfDocument *document, PoDoFo:
   //brect->SetHeight(boundingRect().height());
   //brect->SetWidth(boundingRect().width());
   PoDoFo::PdfAnnotation *annot = pg->CreateAnnotation( PoDoFo::ePdfAnnotation_FreeText, *brect );
-  if ( teXAppearance ) {
-    QByteArray path = tl->inlineRenderer->getPDF( inlineID ).toUtf8();
-    QRectF cropBox = tl->inlineRenderer->getBBox( inlineID );
-    qDebug() << "Appearance BBox (in QT): " << cropBox;
-    PoDoFo::PdfMemDocument pdfDoc( path.data() );
-    PoDoFo::PdfRect pgSz = pdfDoc.GetPage(0)->GetPageSize();
-    PoDoFo::PdfObject trimbox;
-    PoDoFo::PdfRect trim( cropBox.x(), cropBox.y(), cropBox.width(), cropBox.height() );
-    trim.ToVariant(trimbox);
-    PoDoFo::PdfXObject *annotAppearance = new PoDoFo::PdfXObject( pdfDoc, 0, document );
-    annotAppearance->GetContentsForAppending()->GetDictionary().AddKey( PoDoFo::PdfName("BBox"), trimbox );
+  PoDoFo::PdfObject *appearance = NULL;
+  if ( teXAppearance ) appearance = tl->appearanceFor( inlineID, document );
+  if ( appearance ) {
+    PoDoFo::PdfXObject *annotAppearance = new PoDoFo::PdfXObject( appearance );
 //     PoDoFo::PdfDictionary dict,privDict;
 //     try {
 //     privDict.AddKey( "On", annotAppearance->GetObject()->Reference());
@@ -29,9 +29,13 @@
 */
 
 #include "abstractTool.h"
+#include <QtCore/QHash>
+#include <QtCore/QCache>
 #include <QtGui/QGraphicsTextItem>
 #include <QtGui/QIcon>
 
+#include <podofo/podofo.h>
+
 class toolBox;
 class inlineTextAnnotation;
 
@@ -49,6 +53,22 @@ class inlineTextTool : public abstractTool {
 	  void editAnnotationText();
 	  void finishEditing();
 	  void prepareTeX( inlineTextAnnotation *item );
+	  /* Shows the TeX rendering of the text being edited in the tooltip */
+	  void previewTeX( inlineTextAnnotation *item );
+
+	  /* The appearance streams of the snippets are imported into the document
+	   * being saved once per snippet (i.e. a pdf and page, see renderTeX) and
+	   * shared by all the annotations showing it. Each snippet pdf is appended
+	   * to the document once, even if several snippets share it (see
+	   * renderBatch). The parsed snippet pdfs are kept between saves. */
+	  PoDoFo::PdfDocument *saveDocument;
+	  QHash<QString, PoDoFo::PdfObject *> appearances; // owned by saveDocument
+	  QHash<QString, int> importedPdfs; // the offset of the object numbers of each pdf appended to saveDocument
+	  QCache<QString, PoDoFo::PdfMemDocument> snippetPdfs;
+	  /* Returns the page @page of @pdf appended to @document (see importedPdfs) */
+	  PoDoFo::PdfObject *importedPage( const QString &pdfKey, PoDoFo::PdfMemDocument *pdf, int page, PoDoFo::PdfDocument *document );
+	  /* Returns the (imported) appearance of the rendering of item in document */
+	  PoDoFo::PdfObject *appearanceFor( int item, PoDoFo::PdfDocument *document );
 	  
   protected slots:
     
@@ -63,6 +83,7 @@ class inlineTextTool : public abstractTool {
 		virtual bool acceptEventsFor( QGraphicsItem *item );
 		/*virtual bool handleEvent( viewEvent *ev );*/
 		virtual void editItem( abstractAnnotation *item );
+		virtual void beginSave( PoDoFo::PdfDocument *document );
 
 		friend class inlineTextAnnotation;
 
@@ -70,7 +91,6 @@ class inlineTextTool : public abstractTool {
   
 class inlineTextAnnotation : public abstractAnnotation {
   Q_OBJECT
-  static int inlineAnnotationCount;
   private:
     QGraphicsTextItem *item;
     int inlineID;
@@ -79,10 +99,16 @@ class inlineTextAnnotation : public abstractAnnotation {
     
   protected:
     void setTeXAppearance(bool);
+
+  private slots:
+    void textChanged();
    
     
 	  
 	public:
+		enum { Type = inlineTextAnnotationType };
+		int type() const { return Type; };
+
 		inlineTextAnnotation( inlineTextTool *tool, PoDoFo::PdfAnnotation *hilightAnnot = NULL, pdfCoords *transform = NULL );
 		~inlineTextAnnotation();
 
@@ -44,7 +44,7 @@
 QIcon linkTool::icon;
 
 bool linkTool::acceptEventsFor( QGraphicsItem *item ) {
- if ( dynamic_cast<linkAnnotation*>(item) ) {
+ if ( qgraphicsitem_cast<linkAnnotation*>(item) ) {
     return true;
   }
   return false;
@@ -126,7 +126,7 @@ void linkAnnotation::paint(QPainter* painter, const QStyleOptionGraphicsItem* op
 bool linkTool::handleEvent(viewEvent* ev) {
   linkAnnotation *annot;
   if ( ev->type() == viewEvent::VE_MOUSE_PRESS && ( ev->btnCaused() == Qt::LeftButton ) ) {
-    if ( annot = dynamic_cast<linkAnnotation*>(ev->item()) ) { 
+    if ( annot = qgraphicsitem_cast<linkAnnotation*>(ev->item()) ) { 
       //editAnnotationExtent( annot );
     } else {
       QPointF pos = ev->scenePos();
@@ -134,7 +134,7 @@ bool linkTool::handleEvent(viewEvent* ev) {
     }
     return true;
   } else if ( ev->type() == viewEvent::VE_MOUSE_RELEASE && ( ev->btnCaused() == Qt::LeftButton ) ) { 
-    if ( ev->isClick() && (annot = dynamic_cast<linkAnnotation*>(ev->item())) ) {
+    if ( ev->isClick() && (annot = qgraphicsitem_cast<linkAnnotation*>(ev->item())) ) {
       qDebug() << "Going to " << annot->tgt->getName() << " at " << annot->tgt->scenePos();
       emit gotoPos( annot->tgt->scenePos() );
       return true;
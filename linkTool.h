@@ -69,6 +69,9 @@ class linkAnnotation : public abstractAnnotation {
     QRectF activeArea;
   
     public:
+        enum { Type = linkAnnotationType };
+        int type() const { return Type; };
+
         linkAnnotation( linkTool* tool, PoDoFo::PdfAnnotation* Link, pdfCoords* transform = 0 );
         static bool isA( PoDoFo::PdfAnnotation *annotation );
         virtual void saveToPdfPage( PoDoFo::PdfDocument *document, PoDoFo::PdfPage *pg, pdfCoords *coords );
@@ -128,12 +128,16 @@ mainWindow::mainWindow() {
 
 
   connect( searchDlg, SIGNAL( textChanged(QString) ), search, SLOT( searchTermChanged(QString) ) );
+  connect( searchDlg, SIGNAL( termsChanged(QStringList) ), search, SLOT( searchTerms(QStringList) ) );
+  connect( searchDlg, SIGNAL( fuzzyTextChanged(QString,int) ), search, SLOT( searchFuzzy(QString,int) ) );
   connect( searchDlg, SIGNAL( nextMatch() ), search, SLOT( nextMatch() ) ); 
   connect( searchDlg, SIGNAL( prevMatch() ), search, SLOT( prevMatch() ) );
 
   connect( search, SIGNAL( matchFound(int) ), searchDlg, SLOT( setFound() ) );
   connect( search, SIGNAL( matchNotFound() ), searchDlg, SLOT( setMissed() ) );
   connect( search, SIGNAL( clear() ), searchDlg, SLOT( setNone() ) );
+  connect( search, SIGNAL( matchFound(int) ), searchDlg, SLOT( setNumOfMatches(int) ) );
+  connect( search, SIGNAL( termsFound(int) ), searchDlg, SLOT( setNumOfMatches(int) ) );
   connect( search, SIGNAL( currentMatchPosition(const QRectF&) ), this, SLOT( ensureVisible(const QRectF&) ) );
   
   connect( tocView, SIGNAL( activated(const QModelIndex &) ), this, SLOT( tocItemActivated(const QModelIndex &) ) );
@@ -0,0 +1,96 @@
+/**  This file is part of project comment
+ *
+ *  File: matchOverlay.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "matchOverlay.h"
+
+#include <QtGui/QPainter>
+#include <QtGui/QStyleOptionGraphicsItem>
+
+#include <poppler-qt4.h>
+
+using namespace Poppler;
+
+matchOverlayItem::matchOverlayItem( QPointF topLeftPage, const QList< QList<TextBox *> > &matches ):
+	col( 105, 255, 210, 100 ), activeCol( 0, 255, 217, 100 ), active( -1 )
+{
+  int numBoxes = 0;
+  foreach( QList<TextBox *> match, matches ) numBoxes += match.size();
+  boxes.reserve( numBoxes );
+  matchStart.reserve( matches.size()+1 );
+  foreach( QList<TextBox *> match, matches ) { 
+    matchStart.append( boxes.size() );
+    foreach( TextBox *box, match ) { 
+      boxes.append( box->boundingBox() );
+      bBox |= boxes.last();
+    }
+  }
+  matchStart.append( boxes.size() );
+  setFlag( QGraphicsItem::ItemUsesExtendedStyleOption );
+  setAcceptedMouseButtons( Qt::NoButton );
+  setPos( topLeftPage );
+}
+
+void matchOverlayItem::setColor( QColor cl ) { 
+  col = cl;
+  activeCol = cl;
+  update();
+}
+
+void matchOverlayItem::setActive( int match ) { 
+  if ( active == match ) return;
+  if ( active >= 0 ) update( matchRect( active ) );
+  active = ( match < numOfMatches() ) ? match : -1;
+  if ( active >= 0 ) update( matchRect( active ) );
+}
+
+QRectF matchOverlayItem::matchRect( int match ) const { 
+  QRectF ret;
+  if ( match < 0 || match >= numOfMatches() ) return ret;
+  for( int i = matchStart[match]; i < matchStart[match+1]; ++i ) ret |= boxes[i];
+  return ret;
+}
+
+QRectF matchOverlayItem::boundingRect() const { 
+  return bBox;
+}
+
+void matchOverlayItem::paint( QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget ) {
+  const QRectF &exposed = option->exposedRect;
+  const QRectF *bx = boxes.constData();
+  int aStart = -1, aEnd = -1;
+  if ( active >= 0 ) { 
+    aStart = matchStart[active];
+    aEnd = matchStart[active+1];
+  }
+  for( int i = 0; i < boxes.size(); ++i ) { 
+    if ( ! bx[i].intersects( exposed ) ) continue;
+    if ( aStart <= i && i < aEnd ) { 
+      painter->fillRect( bx[i], activeCol );
+      painter->drawRect( bx[i] );
+    } else painter->fillRect( bx[i], col );
+  }
+}
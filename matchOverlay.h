@@ -0,0 +1,72 @@
+#ifndef _matchOverlay_H
+#define _matchOverlay_H
+
+/**  This file is part of comment
+*
+*  File: matchOverlay.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtGui/QGraphicsItem>
+#include <QtGui/QColor>
+#include <QtCore/QVector>
+#include <QtCore/QRectF>
+
+namespace Poppler { 
+  class TextBox;
+};
+
+/* matchOverlayItem --- draws all the search matches on a single page.
+ *                      Instead of one hiliteItem per match it keeps
+ *                      the boxes of all the matches in one flat array,
+ *                      so a common word does not flood the scene with
+ *                      items. Only boxes intersecting the exposed
+ *                      rectangle are painted.
+ */
+class matchOverlayItem : public QGraphicsItem {
+	private:
+		QVector<QRectF> boxes;    // boxes of all matches (page coordinates)
+		QVector<int> matchStart;  // match i consists of boxes [matchStart[i], matchStart[i+1])
+		QRectF bBox;
+		QColor col, activeCol;
+		int active;               // the active match or -1 if none
+
+	public:
+		matchOverlayItem( QPointF topLeftPage, const QList< QList<Poppler::TextBox *> > &matches );
+
+		int numOfMatches() const { return matchStart.size()-1; };
+
+		void setColor( QColor col );
+
+		/* Makes match @match the active one (-1 = no active match) */
+		void setActive( int match );
+		int activeMatch() const { return active; };
+
+		/* Returns the bounding rectangle of match @match in item coordinates */
+		QRectF matchRect( int match ) const;
+
+		virtual QRectF boundingRect() const;
+		void paint( QPainter *, const QStyleOptionGraphicsItem *, QWidget * );
+};
+
+
+#endif /* _matchOverlay_H */
@@ -27,8 +27,14 @@
 
 #include "pageTextLayer.h"
 #include "pdfUtil.h"
+#include "ahoCorasick.h"
+#include "textScan.h"
+#include "fuzzySearch.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QtAlgorithms>
+
+#include <string.h>
 
 #include <poppler-qt4.h>
 
@@ -46,8 +52,9 @@ class line {
 		QList<TextBox*> intervalBoxes( int s, int e );
 	public:
 		int sz,sPos,ePos;
+		int firstWord; // the index (within the page) of the first word on the line
 
-		line( int SPos );
+		line( int SPos, int FirstWord );
 		~line();
 
 		/* takes ownership of the box !!! */
@@ -56,6 +63,8 @@ class line {
 		template <class T> QList<TextBox*> toEnd( T from );
 		template <class T> QList<TextBox*> fromStart( T to );
 		QList<TextBox*> all();
+		/* the index (within the page) of the word at x-coordinate pos */
+		int wordAt( qreal pos ) { return firstWord + getIndex( pos ); };
 		/* returns
 		 *   -1 if y is below
 		 *    0 if y is contained
@@ -65,7 +74,7 @@ class line {
 };
 
 
-line::line(int SPos): sz(0), sPos(SPos), ePos(SPos), minY(-1), maxY(-1), text("") { 
+line::line(int SPos, int FirstWord): sz(0), sPos(SPos), ePos(SPos), firstWord(FirstWord), minY(-1), maxY(-1), text("") { 
   boxes.clear();
 //  wordBoxes.clear();
   wordPosInText.clear();
@@ -202,23 +211,148 @@ QList<TextBox*> line::intervalBoxes( int s, int e ) {
 };
 
 
+pageTextLayer::pageTextLayer() {
+}
+
+void pageTextLayer::addWord( line *ln, TextBox *box, bool space, const QVector<float> &rights ) { 
+  ln->add( box );
+  spaceAfter.resize( words.size()+1 );
+  spaceAfter.setBit( words.size(), space );
+  words.append( box );
+  charStart.append( charRight.size() );
+  charRight += rights;
+}
+
+QRectF pageTextLayer::charBoundingBox( int i, int c ) const { 
+  QRectF bx = words[i]->boundingBox();
+  int first = charStart[i], end = ( i+1 < charStart.size() ) ? charStart[i+1] : charRight.size();
+  if ( c < 0 || first+c >= end ) return QRectF();
+  qreal left = ( c == 0 ) ? bx.left() : charRight[first+c-1];
+  return QRectF( left, bx.top(), charRight[first+c] - left, bx.height() );
+}
+
 pageTextLayer::pageTextLayer( Page *pg ) {
   int posInText = 0;
-  line *ln = new line( posInText );
+  line *ln = new line( posInText, 0 );
   qreal lastx = 0;
+  QVector<float> rights;
   lines.clear();
   foreach( TextBox *box, pg->textList() ) { 
     if (box->boundingBox().x() < lastx ) { //newline
 //     qDebug() << "Adding line: ["<<ln->sPos<<"-"<<ln->ePos<<"]";
 //      pdfUtil::debugPrintTextBoxen( ln->all() );
       lines.append(ln);
-      ln = new line( posInText );
+      ln = new line( posInText, words.size() );
     };
-    ln->add( box );
+    rights.resize( box->text().size() );
+    for( int i = 0; i < rights.size(); ++i ) rights[i] = box->charBoundingBox( i ).right();
+    addWord( ln, box, box->hasSpaceAfter(), rights );
     lastx = box->boundingBox().x();
     posInText += box->text().size() + 1;
     pageText += " " + box->text();
   }
+  if ( ln->sz > 0 ) lines.append( ln );
+  else delete ln;
+}
+
+/* The index blob is a flat sequence of native-endian values:
+ *
+ *   quint32 pageTextSize, ushort pageText[pageTextSize],
+ *   quint32 foldedTextSize, ushort foldedText[foldedTextSize],
+ *   quint32 numLines,
+ *   numLines x ( quint32 numWords,
+ *                numWords x ( qreal x, y, w, h, quint8 spaceAfter,
+ *                             quint32 textSize, ushort text[textSize], float charRight[textSize] ) )
+ *
+ * It is written and read with plain memcpy's, so that it can be
+ * used directly from a memory mapped file. */
+namespace { 
+  template <class T> void appendRaw( QByteArray &blob, T val ) { 
+    blob.append( (const char *) &val, sizeof(T) );
+  }
+
+  void appendRaw( QByteArray &blob, const QString &str ) { 
+    appendRaw( blob, (quint32) str.size() );
+    blob.append( (const char *) str.utf16(), str.size()*sizeof(ushort) );
+  }
+
+  template <class T> bool readRaw( const char *&data, const char *end, T &val ) { 
+    if ( end - data < (int) sizeof(T) ) return false;
+    memcpy( &val, data, sizeof(T) );
+    data += sizeof(T);
+    return true;
+  }
+
+  bool readRaw( const char *&data, const char *end, QString &str ) { 
+    quint32 sz;
+    if ( ! readRaw( data, end, sz ) ) return false;
+    if ( (quint32) (end - data)/sizeof(ushort) < sz ) return false;
+    str.resize( sz );
+    memcpy( str.data(), data, sz*sizeof(ushort) );
+    data += sz*sizeof(ushort);
+    return true;
+  }
+}
+
+QByteArray pageTextLayer::toIndex() const { 
+  QByteArray ret;
+  QRectF bx;
+  QString txt;
+  int w = 0;
+  appendRaw( ret, pageText );
+  appendRaw( ret, pageText.toCaseFolded() ); // not foldedText, the GUI thread can be assigning it (see caseFoldedText)
+  appendRaw( ret, (quint32) lines.size() );
+  foreach( line *ln, lines ) { 
+    QList<TextBox*> boxes = ln->all();
+    appendRaw( ret, (quint32) boxes.size() );
+    foreach( TextBox *box, boxes ) { 
+      bx = box->boundingBox();
+      txt = box->text();
+      appendRaw( ret, bx.x() );
+      appendRaw( ret, bx.y() );
+      appendRaw( ret, bx.width() );
+      appendRaw( ret, bx.height() );
+      appendRaw( ret, (quint8) spaceAfter.testBit( w ) );
+      appendRaw( ret, txt );
+      ret.append( (const char *) ( charRight.constData()+charStart[w] ), txt.size()*sizeof(float) );
+      w++;
+    }
+  }
+  return ret;
+}
+
+pageTextLayer *pageTextLayer::fromIndex( const char *data, int size ) { 
+  const char *end = data+size;
+  pageTextLayer *ret = new pageTextLayer();
+  quint32 numLines, numWords;
+  qreal x, y, w, h;
+  quint8 space;
+  QString text;
+  QVector<float> rights;
+  int posInText = 0;
+  bool ok = readRaw( data, end, ret->pageText ) && readRaw( data, end, ret->foldedText ) && readRaw( data, end, numLines );
+  for( quint32 l = 0; ok && l < numLines; ++l ) { 
+    if ( ! (ok = readRaw( data, end, numWords )) ) break;
+    line *ln = new line( posInText, ret->words.size() );
+    ret->lines.append( ln );
+    for( quint32 i = 0; i < numWords; ++i ) { 
+      ok = readRaw( data, end, x ) && readRaw( data, end, y ) && readRaw( data, end, w ) &&
+	   readRaw( data, end, h ) && readRaw( data, end, space ) && readRaw( data, end, text ) &&
+	   (quint32) (end - data)/sizeof(float) >= (quint32) text.size();
+      if ( ! ok ) break;
+      rights.resize( text.size() );
+      memcpy( rights.data(), data, text.size()*sizeof(float) );
+      data += text.size()*sizeof(float);
+      ret->addWord( ln, new TextBox( text, QRectF( x, y, w, h ) ), space, rights );
+      posInText += text.size() + 1;
+    }
+  }
+  if ( ! ok ) { 
+    qWarning() << "pageTextLayer::fromIndex: Malformed text index.";
+    delete ret;
+    return NULL;
+  }
+  return ret;
 }
 
 pageTextLayer::~pageTextLayer() { 
@@ -276,6 +410,19 @@ QList<TextBox*> pageTextLayer::select( QPointF from, QPointF to ) {
 };
 
 
+int pageTextLayer::wordAt( QPointF pos ) { 
+  if ( lines.size() < 1 ) return -1;
+  return lines[findLine( pos.y() )]->wordAt( pos.x() );
+}
+
+QList<TextBox*> pageTextLayer::wordRange( int first, int last ) const { 
+  QList<TextBox*> ret;
+  if ( first < 0 ) first = 0;
+  if ( last >= words.size() ) last = words.size()-1;
+  for( int i = first; i <= last; ++i ) ret.append( words[i] );
+  return ret;
+}
+
 QList<TextBox*> pageTextLayer::interval( int sPos, int ePos ) { 
   QList<TextBox*> ret;
   int lnS = findLine( sPos ), lnE = findLine( ePos, lnS );
@@ -290,21 +437,61 @@ QList<TextBox*> pageTextLayer::interval( int sPos, int ePos ) {
   return ret; 
 }
 
-QList< QList<TextBox*> > pageTextLayer::findText( QString text ) {
+const QString &pageTextLayer::caseFoldedText() { 
+  if ( foldedText.isNull() ) foldedText = pageText.toCaseFolded();
+  return foldedText;
+}
+
+/* Case insensitive search is done by an exact search of the folded
+ * text for the folded needle. Folding is done character by character,
+ * so positions in the folded text are the same as in pageText */
+QList< QList<TextBox*> > pageTextLayer::findText( QString text, Qt::CaseSensitivity cs ) {
   QList< QList<TextBox*> > ret;
   ret.clear();
-  int pos=0, foundAt=pageText.indexOf( text, pos );
+  if ( text.isEmpty() ) return ret;
+  const QString &hay = ( cs == Qt::CaseInsensitive ) ? caseFoldedText() : pageText;
+  if ( cs == Qt::CaseInsensitive ) text = text.toCaseFolded();
+  int pos=0, foundAt=textScan::indexOf( hay, text, pos );
 
   while ( foundAt >= 0 ) {
  //   qDebug() << " interval( " << foundAt << ", " << foundAt + text.size() -1 << " );";
 //    pdfUtil::debugPrintTextBoxen( interval( foundAt, foundAt + text.size()-1 ) );
     ret+=interval( foundAt, foundAt + text.size()-1 );
     pos=foundAt+text.size();
-    foundAt=pageText.indexOf( text, pos );
+    foundAt=textScan::indexOf( hay, text, pos );
   }
 
   return ret;
 }
 
+QVector< QList< QList<TextBox*> > > pageTextLayer::findTerms( const ahoCorasick &ac ) { 
+  QVector< QList< QList<TextBox*> > > ret( ac.numOfTerms() );
+  QList<ahoCorasick::match> found;
+  if ( ac.caseSensitivity() == Qt::CaseInsensitive ) found = ac.scan( caseFoldedText() );
+  else found = ac.scan( pageText );
+  foreach( ahoCorasick::match m, found ) { 
+    ret[m.term].append( interval( m.pos, m.pos + ac.termLength( m.term )-1 ) );
+  }
+  return ret;
+}
+
+namespace { 
+  bool closerMatch( const fuzzyMatcher::match &a, const fuzzyMatcher::match &b ) { 
+    if ( a.distance != b.distance ) return a.distance < b.distance;
+    return a.pos < b.pos;
+  }
+}
+
+QList< QList<TextBox*> > pageTextLayer::findFuzzy( const fuzzyMatcher &fm, QList<int> &distances ) { 
+  QList< QList<TextBox*> > ret;
+  QList<fuzzyMatcher::match> found = fm.scan( pageText );
+  qSort( found.begin(), found.end(), closerMatch );
+  foreach( fuzzyMatcher::match m, found ) { 
+    ret.append( interval( m.pos, m.pos + m.length-1 ) );
+    distances.append( m.distance );
+  }
+  return ret;
+}
+
 
 
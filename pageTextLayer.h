@@ -31,6 +31,9 @@
 #include <QtCore/QList>
 #include <QtCore/QString>
 #include <QtCore/QPointF>
+#include <QtCore/QByteArray>
+#include <QtCore/QBitArray>
+#include <QtCore/QRectF>
 
 namespace Poppler { 
   class Page;
@@ -38,27 +41,78 @@ namespace Poppler {
 }
 
 class line;
+class ahoCorasick;
+class fuzzyMatcher;
 
 class pageTextLayer { 
 	private:
 		QVector<line*> lines;
+		QVector<Poppler::TextBox*> words; // all the words of the page in reading order (owned by the lines)
 		QString pageText;
+		QString foldedText; // pageText.toCaseFolded(), computed on first use (or read from the text index)
+		QBitArray spaceAfter; // spaceAfter[i] is true if word i is followed by a space
+		QVector<int> charStart; // the characters of word i are charRight[charStart[i]] ...
+		QVector<float> charRight; // the right edge of each character (the characters of a word span its height)
+
+		const QString &caseFoldedText();
 
 //		int findLine( qreal y );
 		template <class T> int findLine( T pos, int minLineHint=0 );
 		QList<Poppler::TextBox*> interval( int startPos, int endPos );
+		/* @rights holds the right edges of the box's characters */
+		void addWord( line *ln, Poppler::TextBox *box, bool space, const QVector<float> &rights );
+
+		pageTextLayer();
 
 	public:
 		pageTextLayer( Poppler::Page *pg );
 		~pageTextLayer();
 
+		/* Serializes the words, their (and their characters') boxes,
+		 * the line structure, the page text and its case folded copy
+		 * searched by the case insensitive searches into a flat blob
+		 * (see textIndex). Does not modify the layer, so it may run in
+		 * a worker thread. */
+		QByteArray toIndex() const;
+
+		/* Recreates the text layer from a blob produced by
+		 * toIndex(), without touching poppler. Returns NULL
+		 * if the blob is malformed. */
+		static pageTextLayer *fromIndex( const char *data, int size );
+
 		/* pageTextLayer retains ownership of
 		 * the returned TextBoxes. So do not
 		 * delete them yourself and do not dereference
 		 * the pointers after deleting pageTextLayer !!! */
 
 		QList<Poppler::TextBox*> select( QPointF from, QPointF to );
-		QList< QList<Poppler::TextBox*> > findText( QString text );
+
+		/* The words are numbered in reading order, so that a
+		 * selection (as returned by select) is always a range of
+		 * consecutive words. wordAt returns the number of the word
+		 * which select would start (or end) at for the point
+		 * @pos (in page coordinates), or -1 if the page has no text. */
+		int wordAt( QPointF pos );
+		int numOfWords() const { return words.size(); };
+		Poppler::TextBox *word( int i ) const { return words[i]; };
+		/* The same as word( @i )->hasSpaceAfter() and word( @i )->charBoundingBox( @c )
+		 * for the words extracted by poppler, but available for the words
+		 * read from the text index, too */
+		bool hasSpaceAfter( int i ) const { return spaceAfter.testBit( i ); };
+		QRectF charBoundingBox( int i, int c ) const;
+		QList<Poppler::TextBox*> wordRange( int first, int last ) const;
+		QList< QList<Poppler::TextBox*> > findText( QString text, Qt::CaseSensitivity cs = Qt::CaseSensitive );
+
+		/* Finds all the terms of the automaton @ac in a single
+		 * pass through the page text. The i-th element of the
+		 * returned vector holds the matches of the i-th term. */
+		QVector< QList< QList<Poppler::TextBox*> > > findTerms( const ahoCorasick &ac );
+
+		/* Finds the approximate matches of @fm, ordered by increasing
+		 * edit distance (and position). The distance of each match is
+		 * appended to @distances. Does not modify the layer, so it may
+		 * run in a worker thread. */
+		QList< QList<Poppler::TextBox*> > findFuzzy( const fuzzyMatcher &fm, QList<int> &distances );
 
 
 };
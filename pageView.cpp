@@ -28,6 +28,7 @@
 #include "pageView.h"
 #include "abstractTool.h"
 #include "myToolTip.h"
+#include "pdfScene.h"
 
 #include <QtCore/QDebug>
 #include <QtGui/QMouseEvent>
@@ -59,9 +60,9 @@ void pageView::disableActions( bool b) {
   }
 }
 
-pageView::pageView( QGraphicsScene *scene, QWidget *parent ) :
+pageView::pageView( pdfScene *scene, QWidget *parent ) :
 	QGraphicsView( scene, parent ), zoom(1), currentPage(1), currentTool(NULL),
-	movingItem(NULL), toolTipItem(NULL) { 
+	movingItem(NULL), toolTipItem(NULL), pdfSc( scene ) { 
 	  setDragMode( QGraphicsView::ScrollHandDrag );
 	}
 
@@ -90,26 +91,23 @@ viewEvent pageView::eventToVE( QMouseEvent *e, viewEvent::eventType tp ) {
  ret.myType = tp;
  ret.SC = scene();
  ret.IT=NULL;
- QList<QGraphicsItem*> itms = items(e->pos());
- for( QList<QGraphicsItem*>::iterator it = itms.begin(); it != itms.end(); ++it ) {
-   ret.topMostAll = dynamic_cast<abstractAnnotation*>(*it);
-   if ( ret.topMostAll ) break;
- }
+ ret.topMostAll=NULL;
+ ret.toolTipCandidate=NULL;
+ ret.movableItem=NULL;
  ret.lastSP=mapToScene( lastMouseEvPos );
  ret.SP=mapToScene( e->pos() );
+ ret.hitList = pdfSc->annotationsAt( ret.SP );
+ foreach( abstractAnnotation *a, ret.hitList ) { 
+   if ( ! ret.topMostAll ) ret.topMostAll = a;
+   if ( ! ret.IT && currentTool && currentTool->acceptEventsFor( a ) ) ret.IT = a;
+   if ( ! ret.toolTipCandidate && a->hasToolTip() ) ret.toolTipCandidate = a;
+   if ( ! ret.movableItem && a->isMovable() ) ret.movableItem = a;
+ }
  ret.bt_caused = e->button();
  ret.bt_state = e->buttons();
  ret.evPos=e->pos();
  ret.lastEvPos=lastMouseEvPos;
  lastMouseEvPos=e->pos();
- if ( currentTool ) { 
-   foreach( QGraphicsItem *i, items( e->pos() ) ) {
-     if ( currentTool->acceptEventsFor( i ) ) {
-       ret.IT = i;
-       break;
-     }
-   }
- }
  return ret;
 };
 
@@ -140,27 +138,15 @@ void pageView::mouseMoveEvent( QMouseEvent *e ) {
 /*    pdfScene *sc = dynamic_cast<pdfScene*>(scene());
     qDebug() << "Currently on Pos:" << hBar->value()<< vBar->value();*/
   } else { // show/hide tooltips
-    abstractAnnotation *annot;
-    bool hide = true;
-    foreach( QGraphicsItem *i, items( viewEv.evPos ) ) { 
-      if ( annot = dynamic_cast<abstractAnnotation*>( i ) ) {
-	if ( annot->hasToolTip() ) {
-	  if ( toolTipItem &&  toolTipItem != annot ) {
-	    qDebug() << "Hiding old tooltip to show new";
-	    toolTipItem->hideToolTip();
-	  } else if ( toolTipItem == annot ) { 
-	    qDebug() << "Tooltip Shown, no need to show more";
-	    hide = false;
-	    break;
-	  }
-	  toolTipItem = annot;
-	  toolTipItem->showToolTip( e->globalPos()+QPoint(10,10) );
-	  hide=false;
-	  break;
-	}
+    abstractAnnotation *annot = viewEv.toolTipCandidate;
+    if ( annot && annot != toolTipItem ) {
+      if ( toolTipItem ) { 
+	qDebug() << "Hiding old tooltip to show new";
+	toolTipItem->hideToolTip();
       }
-    }
-    if ( toolTipItem && hide ) {
+      toolTipItem = annot;
+      toolTipItem->showToolTip( e->globalPos()+QPoint(10,10) );
+    } else if ( toolTipItem && ! annot ) {
       myToolTip::hide();
       if ( currentTool ) currentTool->hideEditor();
       toolTipItem = NULL;
@@ -172,16 +158,11 @@ void pageView::mousePressEvent( QMouseEvent *e ) {
   viewEvent viewEv = eventToVE( e, viewEvent::VE_MOUSE_PRESS );
   viewport()->setCursor(Qt::ClosedHandCursor);
   if ( viewEv.bt_state & Qt::LeftButton ) { // check whether we will be moving an item
-    abstractAnnotation *annot;
-    foreach( QGraphicsItem *i, items( viewEv.evPos ) ) {
-      if ( annot = dynamic_cast<abstractAnnotation*>( i ) ) { 
-	if ( annot->isMovable() ) {
-	  qDebug() << " Moving annotation ";
-	  movingItem = i;
-	  moveDelta = annot->scenePos() - viewEv.SP;
-	  return;
-	}
-      }
+    if ( viewEv.movableItem ) {
+      qDebug() << " Moving annotation ";
+      movingItem = viewEv.movableItem;
+      moveDelta = movingItem->scenePos() - viewEv.SP;
+      return;
     }
     if ( currentTool ) currentTool->handleEvent( &viewEv );
   } else if ( (viewEv.bt_caused & Qt::RightButton) && viewEv.topMostAll ) { // popup-menu
@@ -198,11 +179,8 @@ void pageView::mouseReleaseEvent( QMouseEvent *e ) {
     if ( currentTool->handleEvent( &viewEv ) ) return;
   };
   if ( viewEv.isClick() && ( viewEv.bt_caused == Qt::LeftButton ) ) {
-    abstractAnnotation *annot;
-    foreach( QGraphicsItem *i, items( viewEv.evPos ) ) {
-      if ( annot = dynamic_cast<abstractAnnotation*>( i ) ) { 
-	if ( annot->editSelf() ) return;
-      }
+    foreach( abstractAnnotation *annot, viewEv.hits() ) {
+      if ( annot->editSelf() ) return;
     }
   }
 }
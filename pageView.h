@@ -17,9 +17,11 @@
 #include <QtGui/QGraphicsView>
 #include <QtGui/QMouseEvent>
 #include <QtCore/QPoint>
+#include <QtCore/QList>
 //#include "toolTips.h"
 
 class QGraphicsScene;
+class pdfScene;
 class abstractTool;
 class QGraphicsItem;
 class QKeyEvent;
@@ -39,6 +41,12 @@ class viewEvent {
 		QGraphicsScene *SC;
 		QGraphicsItem *IT;
 		abstractAnnotation *topMostAll;
+		/* The annotations under the mouse (topmost first), classified
+		 * once per event so that the view, the tools and the tooltips
+		 * need not hit-test the scene themselves */
+		QList<abstractAnnotation *> hitList;
+		abstractAnnotation *toolTipCandidate; // the topmost annotation with a tooltip
+		abstractAnnotation *movableItem; // the topmost movable annotation
 		Qt::MouseButton bt_caused;
 		Qt::MouseButtons bt_state;
 		QWidget *viewPort;
@@ -58,6 +66,9 @@ class viewEvent {
 		QGraphicsScene *scene() { return SC;};
 		QGraphicsItem *item() { return IT;};
 		abstractAnnotation *topItem() { return topMostAll;};
+		abstractAnnotation *toolTipItem() { return toolTipCandidate; };
+		abstractAnnotation *movableAnnotation() { return movableItem; };
+		const QList<abstractAnnotation *> &hits() { return hitList; };
 		eventType type() { return myType;};
 		bool isClick();
 		
@@ -77,6 +88,7 @@ class pageView : public QGraphicsView {
 		QGraphicsItem *movingItem;
 		QPointF moveDelta;
 		abstractTool *currentTool;
+		pdfScene *pdfSc;
 
 	protected:
 	  viewEvent eventToVE( QMouseEvent *e, viewEvent::eventType tp );
@@ -88,7 +100,7 @@ class pageView : public QGraphicsView {
 
 
 	public:
-		pageView( QGraphicsScene *scene, QWidget *parent = 0 );
+		pageView( pdfScene *scene, QWidget *parent = 0 );
 
 		QAction *newAction( QString shortCut, QObject *target, const char * ); 
 
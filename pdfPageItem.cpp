@@ -29,20 +29,25 @@
 #include <poppler-qt4.h>
 
 #include "pdfPageItem.h"
+#include "documentPool.h"
 
 #include <QtGui/QPainter>
 #include <QtGui/QImage>
 #include <QtGui/QStyleOptionGraphicsItem>
 #include <QtCore/QDebug>
+#include <QtCore/QtConcurrentRun>
 
 
 QCache<int, struct pdfPageItem::cachedPage> pdfPageItem::renderCache(200);
 
 pdfPageItem::~pdfPageItem() {
+  waitForRendering(); // the rendering uses the pool, which is deleted after the page
   delete pdfPage;
 }
 
-pdfPageItem::pdfPageItem( Poppler::Page *page ) : pdfPage( page ) {
+pdfPageItem::pdfPageItem( Poppler::Page *page ) : pdfPage( page ), pool( NULL ), renderingZoom( 0 ) {
+  renderWatcher = new QFutureWatcher<QImage>( this );
+  connect( renderWatcher, SIGNAL( finished() ), this, SLOT( renderingFinished() ) );
 };
 
 QRectF pdfPageItem::boundingRect() const { 
@@ -59,16 +64,27 @@ void pdfPageItem::paint( QPainter *painter, const QStyleOptionGraphicsItem *opti
 #endif
   cachedPage *page = renderCache.object( pageNum );
   QPixmap pix;
+  qreal pixZoom = zoom; // the zoom pix was rendered at
   
-  if ( ! page ) pix = populateCache( zoom );
+  if ( pool ) { 
+    if ( ! page || zoom != page->zoom ) startRendering( zoom );
+    if ( page ) { // the old rendering is scaled until the new one is ready
+      pix = page->pix;
+      pixZoom = page->zoom;
+    }
+  } else if ( ! page ) pix = populateCache( zoom );
   else if ( zoom != page->zoom ) { 
     renderCache.remove( pageNum );
     pix = populateCache( zoom );
   } else pix = page->pix;
   QRectF exposed = option->exposedRect;
+  if ( pix.isNull() ) { 
+    painter->fillRect( exposed, Qt::white );
+    return;
+  }
   qreal x,y,w,h;
   option->exposedRect.getRect( &x, &y, &w, &h );
-  painter->drawPixmap( exposed, pix, QRectF( x*zoom,y*zoom,w*zoom,h*zoom ) );
+  painter->drawPixmap( exposed, pix, QRectF( x*pixZoom,y*pixZoom,w*pixZoom,h*pixZoom ) );
 
 /*  QRectF exposed = option->exposedRect;
   qreal x,y,w,h;
@@ -86,4 +102,37 @@ QPixmap pdfPageItem::populateCache( qreal zoom ) {
   renderCache.insert( pageNum, page, (int) (zoom*10) );
   return page->pix;
 }
-  
+
+void pdfPageItem::startRendering( qreal zoom ) { 
+  if ( renderWatcher->isRunning() ) return; // when it finishes, paint starts again if the zoom changed
+  renderingZoom = zoom;
+  renderWatcher->setFuture( QtConcurrent::run( renderPage, pool, pageNum, zoom ) );
+}
+
+QImage pdfPageItem::renderPage( documentPool *pool, int pgNum, qreal zoom ) { 
+  documentLease lease( pool, pgNum );
+  Poppler::Page *pg = lease.page();
+  if ( ! pg ) return QImage();
+  QImage image = pg->renderToImage( 72*zoom, 72*zoom );
+  delete pg;
+  return image;
+}
+
+void pdfPageItem::renderingFinished() { 
+  QImage image = renderWatcher->result();
+  if ( image.isNull() ) { // not repainted, so that a page which cannot be rendered is not retried over and over
+    qWarning() << "pdfPageItem: Could not render page" << pageNum;
+    return;
+  }
+  cachedPage *page = new cachedPage;
+  page->pix = QPixmap::fromImage( image );
+  page->zoom = renderingZoom;
+  renderCache.insert( pageNum, page, (int) (renderingZoom*10) );
+  update();
+}
+
+void pdfPageItem::waitForRendering() { 
+  renderWatcher->waitForFinished();
+}
+
+#include "pdfPageItem.moc"
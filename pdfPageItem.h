@@ -26,9 +26,11 @@
 *  Boston, MA 02110-1301, USA.
 */
 
-#include <QtGui/QGraphicsItem>
+#include <QtGui/QGraphicsObject>
+#include <QtGui/QImage>
 #include <QtCore/QRectF>
 #include <QtCore/QCache>
+#include <QtCore/QFutureWatcher>
 
 namespace Poppler {
   class Page;
@@ -37,9 +39,16 @@ namespace Poppler {
 class QPainter;
 class QStyleOptionGraphicsItem;
 class QWidget;
+class documentPool;
 
 
-class pdfPageItem : public QGraphicsItem { 
+/* pdfPageItem --- a page of the pdf. If the item is given a documentPool,
+ *                 the page is rendered in a worker thread (on a document
+ *                 leased from the pool) and the previous rendering, scaled
+ *                 to the current zoom, is shown in the meantime. Without
+ *                 a pool the page is rendered directly in paint. */
+class pdfPageItem : public QGraphicsObject { 
+  Q_OBJECT
 	private:
 		Poppler::Page *pdfPage;
 		int pageNum;
@@ -49,6 +58,16 @@ class pdfPageItem : public QGraphicsItem {
 		};
 		static QCache<int, struct cachedPage> renderCache;
 		QPixmap populateCache( qreal zoom );
+
+		documentPool *pool;
+		QFutureWatcher<QImage> *renderWatcher;
+		qreal renderingZoom; // the zoom renderWatcher is rendering at
+		void startRendering( qreal zoom );
+		static QImage renderPage( documentPool *pool, int pgNum, qreal zoom );
+
+	private slots:
+		void renderingFinished();
+
 	public:
 		pdfPageItem( Poppler::Page *page );
 		~pdfPageItem();
@@ -59,6 +78,13 @@ class pdfPageItem : public QGraphicsItem {
 		int getPageNum() const { return pageNum;};
 		void paint( QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget );
 
+		/* Renders the page with documents leased from @Pool (NULL to
+		 * render in the GUI thread). The pool must outlive the rendering,
+		 * see waitForRendering. */
+		void setDocumentPool( documentPool *Pool ) { pool = Pool; };
+		/* Waits until the page rendered in the background (if any) is done */
+		void waitForRendering();
+
 };
 
 #endif // PDFPAGEITEM_H
@@ -35,6 +35,11 @@
 #include "sceneLayer.h"
 #include "linkLayer.h"
 #include "toc.h"
+#include "ahoCorasick.h"
+#include "textIndex.h"
+#include "fuzzySearch.h"
+#include "selectionSession.h"
+#include "documentPool.h"
 
 #include <QtCore/QFile>
 #include <QtCore/QTemporaryFile>
@@ -48,6 +53,9 @@
 #include <QtCore/QTemporaryFile>
 #include <QtCore/QDebug>
 #include <QtCore/QEvent>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QtConcurrentMap>
+#include <QtCore/QtConcurrentRun>
 
 #include <poppler-qt4.h>
 #include <podofo/podofo.h>
@@ -55,14 +63,14 @@
 using namespace Poppler;
 
 pdfScene::pdfScene(): 
-	pdf(NULL), tempFileName(""), numPages(0), leftSkip(10), pageSkip(10), prop(NULL), TOC(NULL)
+	pdf(NULL), docPool(NULL), tempFileName(""), numPages(0), leftSkip(10), pageSkip(10), prop(NULL), TOC(NULL)
 {
   links = new linkLayer( this );
   setBackgroundBrush(Qt::gray);
 }
 
 pdfScene::pdfScene( const QSet<abstractTool *> &tools, QString fName ):
-	tools(tools), pdf(NULL), tempFileName(""), numPages(0), leftSkip(10), pageSkip(10),
+	tools(tools), pdf(NULL), docPool(NULL), tempFileName(""), numPages(0), leftSkip(10), pageSkip(10),
 	prop(NULL), TOC(NULL)
 {
   links = new linkLayer( this );
@@ -71,7 +79,10 @@ pdfScene::pdfScene( const QSet<abstractTool *> &tools, QString fName ):
 }
 
 pdfScene::~pdfScene() { 
+  waitForTextIndex();
+  waitForPageRendering(); // the pages are deleted (by QGraphicsScene) only after the pool
   delete prop;
+  delete docPool;
   delete pdf;
   delete links;
   delete TOC;
@@ -146,6 +157,41 @@ void pdfScene::processPage( PoDoFo::PdfDocument *pdf, int pgNum ) {
  *    move this stuff into the pageView class, but I currently don't
  *    have the motivation, since in the near future there will always
  *    be only a single view */
+namespace { 
+  /* Extracts the text of a single page using a document leased
+   * from the pool, used by QtConcurrent::blockingMapped in loadPopplerPdf */
+  struct extractPageText { 
+    typedef pageTextLayer *result_type;
+
+    documentPool *pool;
+
+    extractPageText( documentPool *Pool ): pool( Pool ) {}
+
+    pageTextLayer *operator()( int page ) const { 
+      documentLease lease( pool, page );
+      Poppler::Page *pg = lease.page();
+      if ( ! pg ) return NULL;
+      pageTextLayer *ret = new pageTextLayer( pg );
+      delete pg;
+      return ret;
+    }
+  };
+
+  /* Writes the sidecar, runs in a worker thread (the text layers
+   * are only read, so the GUI can use them in the meantime) */
+  void writeTextIndex( textIndex *index, QVector<pageTextLayer *> layers, QString docFile ) { 
+    if ( ! index->save( layers, docFile ) ) qWarning() << "Could not save the text index to" << index->fileName();
+    delete index;
+  }
+
+  /* Removes the sidecar if it does not belong to the contents of @docFile
+   * (the next load rebuilds it), runs in a worker thread */
+  void verifyTextIndex( textIndex *index, QString docFile ) { 
+    index->verify( docFile );
+    delete index;
+  }
+}
+
 // assumes pdf == NULL ( otherwise there will be a memory leak ! )
 void pdfScene::loadPopplerPdf( QString fileName, QObject *pageInViewReceiver, const char *slot ) { 
   QPointF annotationPos;
@@ -157,10 +203,24 @@ void pdfScene::loadPopplerPdf( QString fileName, QObject *pageInViewReceiver, co
   pageBeginItem *beginMarker;
   pageCorners.clear();
   qreal y=pageSkip;
+  textIndex index( contentHash );
+  bool haveIndex = index.open( numPages );
+  pageTextLayer *layer;
+  waitForPageRendering();
+  delete docPool;
+  docPool = NULL;
+  getDocumentPool(); // the pages are rendered in the worker threads
+  QList<pageTextLayer *> extracted;
+  if ( ! haveIndex && docPool ) { // no sidecar, extract the text of all the pages in parallel
+    QList<int> pages;
+    for( int i = 0; i < numPages; i++ ) pages.append( i );
+    extracted = QtConcurrent::blockingMapped< QList<pageTextLayer *> >( pages, extractPageText( docPool ) );
+  }
 //  wordItem *it;
   for(int i = 0; i < numPages; i++ ) {
     pageItem = new pdfPageItem( pdf->page( i ) );
     pageItem->setPageNum( i );
+    pageItem->setDocumentPool( docPool ); // NULL if the pool could not be opened, then the page renders itself
     pageItem->setZValue( 0 );
     addItem( pageItem );
     pageItem->setPos(leftSkip,y);
@@ -178,7 +238,11 @@ void pdfScene::loadPopplerPdf( QString fileName, QObject *pageInViewReceiver, co
       it = new wordItem( word );
       it->setParentItem( pageItem );
     }*/
-    textLayer.append( new pageTextLayer( pageItem->getPage() ) );
+    layer = NULL;
+    if ( haveIndex && ! (layer = index.pageLayer( i )) ) haveIndex = false;
+    if ( ! layer && i < extracted.size() ) layer = extracted[i];
+    if ( ! layer ) layer = new pageTextLayer( pageItem->getPage() );
+    textLayer.append( layer );
 //    txt = new textLayer( pageItem->getPage() );
 //    txt->setParentItem( pageItem );
     addPageAnnotations( i, pageItem );
@@ -186,6 +250,30 @@ void pdfScene::loadPopplerPdf( QString fileName, QObject *pageInViewReceiver, co
     qDebug() << i;
     connect( beginMarker->getSignalEmitter(), SIGNAL( pageInView(int) ), pageInViewReceiver, slot );
   }
+  // The sidecar is missing or stale, rebuild it in the background
+  if ( ! haveIndex ) saveTextIndex();
+  else indexJob = QtConcurrent::run( verifyTextIndex, new textIndex( contentHash ), myFileName ); // the key does not read the whole file
+}
+
+documentPool *pdfScene::getDocumentPool() { 
+  if ( ! docPool && pdf ) docPool = documentPool::load( QFile::decodeName( tempFileName ) );
+  return docPool;
+}
+
+void pdfScene::saveTextIndex() { 
+  if ( textLayer.size() != numPages ) return;
+  indexJob = QtConcurrent::run( writeTextIndex, new textIndex( contentHash ), textLayer, myFileName );
+}
+
+void pdfScene::waitForTextIndex() { 
+  indexJob.waitForFinished();
+}
+
+void pdfScene::waitForPageRendering() { 
+  pdfPageItem *pg;
+  foreach( QGraphicsItem *item, items() ) { 
+    if ( ( pg = dynamic_cast<pdfPageItem*>( item ) ) ) pg->waitForRendering();
+  }
 }
 
 /* Iterates through the annotations on page pageNum and adds them 
@@ -210,7 +298,9 @@ void pdfScene::generateTempFileName() { // FIXME: can fail !!!
 
 bool pdfScene::loadFromFile( QString fileName, QObject *pageInViewReceiver, const char *slot ) {
   if ( !QFile::exists(fileName) ) return false;
+  waitForTextIndex(); // it may still be writing the sidecar of the previous file
   QByteArray flnm = QFile::encodeName( fileName );
+  contentHash = textIndex::hashFile( fileName );
   PoDoFo::PdfMemDocument pdfDoc;
   try { 
     pdfDoc.Load( flnm.data() );
@@ -218,6 +308,7 @@ bool pdfScene::loadFromFile( QString fileName, QObject *pageInViewReceiver, cons
     qDebug() << "Error loading file:" << error.what();
     return false;
   }
+  myFileName = fileName; // the text index is checked against it
   links->loadFromDoc( &pdfDoc );
   numPages = pdfDoc.GetPageCount();
   annotations.resize( numPages );
@@ -226,7 +317,6 @@ bool pdfScene::loadFromFile( QString fileName, QObject *pageInViewReceiver, cons
   pdfDoc.Write( tempFileName.data() );
   loadPopplerPdf( tempFileName, pageInViewReceiver, slot );
   annotations.clear();
-  myFileName = fileName;
   prop = new pdfProperties;
   fillPdfProperties();
   delete TOC;
@@ -250,6 +340,7 @@ bool pdfScene::saveToFile( QString fileName ) {
     return false;
   } 
   links->saveToDoc( &pdfDoc );
+  foreach( abstractTool *tool, tools ) tool->beginSave( &pdfDoc );
   foreach( QGraphicsItem *item, items() ) { 
     if ( a = dynamic_cast< abstractAnnotation *>(item) ) {
       pgItem = dynamic_cast<pdfPageItem*>(a->parentItem());
@@ -334,6 +425,38 @@ void pdfScene::placeAnnotation( abstractAnnotation *annot, const QPointF *scPos
   qDebug() << "Placing Annotation at page " << pg << " relative position " << parentPage->mapFromScene( *scPos ) << "=="<<annot->pos()<< " absolute position " << *scPos;
 }
 
+QList<abstractAnnotation *> pdfScene::annotationsAt( const QPointF &scenePos ) { 
+  int pg = posToPage( scenePos );
+  return annotIndex.at( pg, scenePos - topLeftPage( pg ), scenePos );
+}
+
+void pdfScene::updateAnnotationIndex( abstractAnnotation *annot ) { 
+  pdfPageItem *pg = dynamic_cast<pdfPageItem*>( annot->parentItem() );
+  if ( ! pg || annot->scene() != this ) { 
+    annotIndex.remove( annot );
+    return;
+  }
+  // e.g. a hilight can reach over a page break, it is indexed on every page it covers
+  QRectF sceneRect = annot->mapRectToScene( annot->boundingRect() );
+  QMap<int, QRectF> pageRects;
+  int last = posToPage( sceneRect.bottomLeft() );
+  pdfPageItem *page;
+  QRectF onPage;
+  for( int i = qMin( pg->getPageNum(), posToPage( sceneRect.topLeft() ) ); i <= last; ++i ) { 
+    page = ( i == pg->getPageNum() ) ? pg : getPageItem( i );
+    if ( ! page ) continue;
+    onPage = sceneRect.translated( -topLeftPage( i ) ) & page->boundingRect(); // only the part on the page can be hit there
+    if ( ! onPage.isEmpty() ) pageRects.insert( i, onPage );
+  }
+  // an annotation moved off its page can still be hit on it
+  if ( pageRects.isEmpty() ) pageRects.insert( pg->getPageNum(), sceneRect.translated( -topLeftPage( pg->getPageNum() ) ) );
+  annotIndex.insert( annot, pageRects );
+}
+
+void pdfScene::removeFromAnnotationIndex( abstractAnnotation *annot ) { 
+  annotIndex.remove( annot );
+}
+
 pdfPageItem *pdfScene::getPageItem( int pgNum ) { 
   QPointF topLeft = topLeftPage( pgNum );
   pdfPageItem *pg;
@@ -368,6 +491,11 @@ int pdfScene::posToPage( const QPointF &scenePos ) {
 };
 
 
+pageTextLayer *pdfScene::getTextLayer( int page ) { 
+  if ( page < 0 || page >= textLayer.size() ) return NULL;
+  return textLayer[page];
+}
+
 QPointF pdfScene::topLeftPage( int page ) {
   if ( page < pageCorners.size() ) return pageCorners[page];
   return QPointF(0,0);
@@ -394,7 +522,7 @@ QList<TextBox *> pdfScene::selectText( QPointF from, QPointF to ) {
   return textLayer[pg]->select( fromP, toP );
 }
 
-QList< pageSelections > pdfScene::findText( QString text, int startPage, int endPage ) { 
+QList< pageSelections > pdfScene::findText( QString text, int startPage, int endPage, Qt::CaseSensitivity cs ) { 
   int totalNumOfMatches = 0;
   if ( endPage == -1 || endPage >= numPages ) endPage = numPages;
   if ( startPage < 0 ) startPage = 0;
@@ -403,7 +531,7 @@ QList< pageSelections > pdfScene::findText( QString text, int startPage, int end
   ret.clear();
   for( int i = startPage; i < endPage; ++i ) { 
     sel.pageNum = i;
-    sel.selections=textLayer[i]->findText( text );
+    sel.selections=textLayer[i]->findText( text, cs );
     if ( sel.selections.size() > 0 ) {
       ret.append( sel );
       totalNumOfMatches += sel.selections.size();
@@ -412,12 +540,69 @@ QList< pageSelections > pdfScene::findText( QString text, int startPage, int end
   return ret;
 }
 
-QString pdfScene::selectedText( QPointF from, QPointF to ) { 
-  QList<TextBox*> selection = selectText( from, to );
-  QString ret;
-  foreach( TextBox *box, selection ) ret+=box->text()+" ";
+namespace { 
+  /* Searches a single page, used by QtConcurrent::mapped in findTextFuzzy */
+  struct fuzzyPageSearch { 
+    typedef pageSelections result_type;
+
+    QSharedPointer<fuzzyMatcher> matcher;
+    QVector<pageTextLayer *> layers;
+
+    fuzzyPageSearch( fuzzyMatcher *fm, const QVector<pageTextLayer *> &textLayers ):
+	    matcher( fm ), layers( textLayers )
+    {}
+
+    pageSelections operator()( int page ) const { 
+      pageSelections sel;
+      sel.pageNum = page;
+      sel.selections = layers[page]->findFuzzy( *matcher, sel.distances );
+      return sel;
+    }
+  };
+}
+
+QFuture< pageSelections > pdfScene::findTextFuzzy( QString text, int maxErrors, int startPage, int endPage, Qt::CaseSensitivity cs ) { 
+  if ( endPage == -1 || endPage >= numPages ) endPage = numPages;
+  if ( startPage < 0 ) startPage = 0;
+  fuzzyMatcher *fm = new fuzzyMatcher( text, maxErrors, cs );
+  QList<int> pages;
+  if ( fm->isValid() ) for( int i = startPage; i < endPage; ++i ) pages.append( i );
+  else qWarning() << "pdfScene::findTextFuzzy: the search text must have between 1 and" << fuzzyMatcher::maxPatternLength << "characters";
+  return QtConcurrent::mapped( pages, fuzzyPageSearch( fm, textLayer ) );
+}
+
+QList< termSelections > pdfScene::findTerms( const QStringList &terms, Qt::CaseSensitivity cs, int startPage, int endPage ) { 
+  if ( endPage == -1 || endPage >= numPages ) endPage = numPages;
+  if ( startPage < 0 ) startPage = 0;
+  ahoCorasick ac( terms, cs );
+  QList< termSelections > ret;
+  termSelections tsel;
+  pageSelections sel;
+  for( int t = 0; t < ac.numOfTerms(); ++t ) { 
+    tsel.term = ac.term( t );
+    tsel.numOfMatches = 0;
+    ret.append( tsel );
+  }
+  QVector< QList< QList<TextBox*> > > pageMatches;
+  for( int i = startPage; i < endPage; ++i ) { 
+    sel.pageNum = i;
+    pageMatches = textLayer[i]->findTerms( ac );
+    for( int t = 0; t < pageMatches.size(); ++t ) { 
+      if ( pageMatches[t].size() > 0 ) { 
+	sel.selections = pageMatches[t];
+	ret[t].pages.append( sel );
+	ret[t].numOfMatches += sel.selections.size();
+      }
+    }
+  }
   return ret;
 }
 
+QString pdfScene::selectedText( QPointF from, QPointF to ) { 
+  selectionSession selection( this, from );
+  selection.extendTo( to );
+  return selection.text();
+}
+
 
 #include "pdfScene.moc"
\ No newline at end of file
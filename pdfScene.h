@@ -29,11 +29,15 @@
 
 #include <QtGui/QGraphicsScene>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 #include <QtCore/QVector>
 #include <QtCore/QList>
 #include <QtCore/QSet>
+#include <QtCore/QFuture>
 //#include <QtGui/QPointF>
 
+#include "annotationIndex.h"
+
 class abstractTool;
 class abstractAnnotation;
 class QGraphicsItem;
@@ -56,6 +60,7 @@ namespace Poppler {
 
 class pdfCoords;
 class pageTextLayer;
+class documentPool;
 class sceneLayer;
 class linkLayer;
 class toc;
@@ -68,9 +73,17 @@ QString Poppler::TextBox::text() const;*/
 struct pageSelections {
 	public:
 		QList< QList<Poppler::TextBox *> > selections;
+		QList< int > distances; // the edit distance of each selection (only filled by fuzzy search)
 		int pageNum;
 };
 
+struct termSelections {
+	public:
+		QString term;
+		QList< pageSelections > pages;
+		int numOfMatches;
+};
+
 
 class pdfScene : public QGraphicsScene {
   Q_OBJECT
@@ -81,6 +94,7 @@ class pdfScene : public QGraphicsScene {
 		QVector< QList<abstractAnnotation *> > annotations;
 		QVector<QPointF> pageCorners; // holds the top left corners of each page
 		QVector<pageTextLayer *> textLayer;
+		annotationIndex annotIndex; // a spatial index of the annotations placed on the pages, used for hit-testing
 		linkLayer *links;
 		toc *TOC;
 		QList<sceneLayer *> sceneLayers;
@@ -99,12 +113,16 @@ class pdfScene : public QGraphicsScene {
 		 *    the annotations and writing out the file to myFileName (or a
 		 *    filename provided to the saveToFile method */
 		QByteArray tempFileName; // the temporary file 
+		QByteArray contentHash; // identifies the file contents (see textIndex::hashFile), used to find the text index sidecar
 		int numPages; // number of pages;
 
 		struct pdfProperties *prop;
 		void fillPdfProperties();
 		void savePdfProperties( PoDoFo::PdfMemDocument *pdfDoc );
 		Poppler::Document *pdf; // When a document is loaded, this holds the poppler document
+		documentPool *docPool; // independent copies of pdf for the worker threads (text extraction, page rendering)
+		/* Waits until the pages rendered in the background (using docPool) are done */
+		void waitForPageRendering();
 
 		void processPage( PoDoFo::PdfDocument *pdf, int pgNum ); //
 		void loadPopplerPdf( QString fileName, QObject *pageInViewReceiver, const char *slot );
@@ -114,6 +132,13 @@ class pdfScene : public QGraphicsScene {
 
 		pdfPageItem *getPageItem( int pgNum );
 
+		/* Writes the text layers into the text index sidecar (in a
+		 * worker thread), so that the next load need not extract them again */
+		void saveTextIndex();
+		QFuture<void> indexJob; // the sidecar writer (or verifier) running in the background
+		/* Waits for indexJob, the writer reads the text layers */
+		void waitForTextIndex();
+
 	public:
 		pdfScene();
 		pdfScene( const QSet<abstractTool *> &tools, QString fileName = "");
@@ -142,10 +167,31 @@ class pdfScene : public QGraphicsScene {
 		 * then returns (0,0) */
 		QPointF topLeftPage( int page );
 
+		/* Returns the pool of Poppler documents for extracting text and
+		 * rendering pages in worker threads (pdf itself may only be used
+		 * from the GUI thread), the pool is opened on the first call.
+		 * NULL if no document is loaded. */
+		documentPool *getDocumentPool();
+
+		/* Returns the text layer of page @page (zero based)
+		 * or NULL if there is no such page */
+		pageTextLayer *getTextLayer( int page );
+
 		/* Places the annotation annot ( which must not be NULL )
 		 * on the page determined by the scene position scPos */
 		void placeAnnotation( abstractAnnotation *annot, const QPointF *scPos ); 
 
+		/* Returns the (visible) annotations at the scene position
+		 * scenePos, the topmost first. Uses the annotation index
+		 * instead of querying the scene. */
+		QList<abstractAnnotation *> annotationsAt( const QPointF &scenePos );
+
+		/* Called by the annotations when they are moved, reparented
+		 * or change their geometry. Annotations which are not placed
+		 * on a page of this scene are removed from the index. */
+		void updateAnnotationIndex( abstractAnnotation *annot );
+		void removeFromAnnotationIndex( abstractAnnotation *annot );
+
 		/****************************************************
 		 * GENERAL LAYER FUNCTIONS                          *
 		 ****************************************************/
@@ -171,8 +217,9 @@ class pdfScene : public QGraphicsScene {
 		 * Currently the granularity is along word boundaries
 		 * (i.e. you cannot select a single character) but in the
 		 * future this might change. 
-		 * Also note that currently selections spanning across
-		 * pages are not possible.
+		 * Also note that this method does not select across
+		 * pages (@to is taken relative to the page containing @from),
+		 * use a selectionSession for selections spanning several pages.
 		 *
 		 * Note: The BBoxes in the returned lists are in page
 		 * coordinates of the page containing the point from.
@@ -181,16 +228,17 @@ class pdfScene : public QGraphicsScene {
 		 */
 		QList<Poppler::TextBox*> selectText( QPointF from, QPointF to );
 
-		/* Uses the last method to get a list of words and
-		 * then concatenates their text content together (i.e. discards
-		 * the bbox information) and returns it
-		 * both @from and @to are in scene coordinates */
+		/* Returns the text of the words selected between @from
+		 * and @to (both in scene coordinates) separated by spaces.
+		 * Unlike selectText, the selection may span several pages
+		 * (see selectionSession). */
 
 		QString selectedText( QPointF from, QPointF to );
 
 		/* Returns a list of words whose start matches @text,
 		 * optionally starting at @startPage (zero-based) and
-		 * optionally (if @endPage >=0) ending @endPage
+		 * optionally (if @endPage >=0) ending @endPage.
+		 * The search is case insensitive if @cs is Qt::CaseInsensitive
 		 *
 		 * Note: The BBoxes in the returned lists are in page
 		 * coordinates.
@@ -198,7 +246,32 @@ class pdfScene : public QGraphicsScene {
 		 * Note: pdfScene retains ownership of the Poppler::TextBoxes!
 		 */
 
-		QList< pageSelections > findText( QString text, int startPage = 0, int endPage = -1 );
+		QList< pageSelections > findText( QString text, int startPage = 0, int endPage = -1, Qt::CaseSensitivity cs = Qt::CaseSensitive );
+
+		/* Fuzzy search: finds the places where @text occurs with at
+		 * most @maxErrors edits (insertions, deletions, substitutions),
+		 * which is useful for OCR'd documents. @text may have at most
+		 * 64 characters. The pages are searched in parallel on the
+		 * global thread pool and the returned future receives one
+		 * pageSelections per page (with no selections if there is no
+		 * match on the page) as soon as the page is done, so use a
+		 * QFutureWatcher to get the results as they come. The selections
+		 * on each page are ordered by their edit distance (see the
+		 * distances member).
+		 *
+		 * Note: pdfScene retains ownership of the Poppler::TextBoxes!
+		 */
+		QFuture< pageSelections > findTextFuzzy( QString text, int maxErrors, int startPage = 0, int endPage = -1, Qt::CaseSensitivity cs = Qt::CaseInsensitive );
+
+		/* Searches for all the @terms at once (building a single
+		 * Aho-Corasick automaton and scanning each page only once).
+		 * The i-th element of the result holds the matches of the
+		 * i-th (nonempty) term, pages without matches are omitted.
+		 * @startPage and @endPage have the same meaning as in findText.
+		 *
+		 * Note: pdfScene retains ownership of the Poppler::TextBoxes!
+		 */
+		QList< termSelections > findTerms( const QStringList &terms, Qt::CaseSensitivity cs = Qt::CaseSensitive, int startPage = 0, int endPage = -1 );
 		
   signals:
     void finishedLoading();
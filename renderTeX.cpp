@@ -27,14 +27,38 @@
 
 #include "teXjob.h"
 #include "renderTeX.h"
+#include "compileScheduler.h"
+#include "teXCache.h"
+#include "config.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QTimer>
+#include <QtCore/QSignalMapper>
+#include <QtCore/QtConcurrentRun>
 
-QCache<int, struct renderTeX::cachedPage> renderTeX::renderCache(200000);
+static const int maxBatchSize = 64;
+static const qreal mipmapZoom = 4; // the zoom items are rasterized at (unless a larger one is wanted)
 
 renderTeX::renderTeX( QString preamb ):
-	preambule( preamb )
+	renderCache( 64*1024 ), hits( 0 ), misses( 0 ), preambule( preamb ), previewDelay( 300 )
 {
+  if ( config().haveKey( "tex_pixmap_cache" ) && config()["tex_pixmap_cache"].toInt() > 0 ) renderCache.setMaxCost( config()["tex_pixmap_cache"].toInt()*1024 );
+  if ( config().haveKey( "tex_preview_delay" ) && config()["tex_preview_delay"].toInt() > 0 ) previewDelay = config()["tex_preview_delay"].toInt();
+  if ( config().haveTeX() ) teXCache::resolveEngine( config()["tex"] ); // ready before the first compilation needs it
+  previewMapper = new QSignalMapper( this );
+  connect( previewMapper, SIGNAL( mapped(int) ), this, SLOT( previewTimeout(int) ) );
+  engineWatcher = new QFutureWatcher<QString>( this );
+  connect( engineWatcher, SIGNAL( finished() ), this, SLOT( engineResolved() ) );
+}
+
+renderTeX::~renderTeX() { 
+  qDeleteAll( items );
+}
+
+renderTeX *renderTeX::instance() { 
+  static renderTeX *renderer = new renderTeX;
+  return renderer;
 }
 
 void renderTeX::setPaths( QString latex, QString gs ) { 
@@ -45,110 +69,391 @@ void renderTeX::setPreambule( QString preamb ) {
   preambule = preamb;
 }
 
+QString renderTeX::contentKey( const QString &source, const QString &preamb ) { 
+  QCryptographicHash md5( QCryptographicHash::Md5 );
+  md5.addData( preamb.toUtf8() );
+  md5.addData( "\0", 1 );
+  md5.addData( source.toUtf8() );
+  return QString( md5.result().toHex() );
+}
+
+int renderTeX::index( int id ) const { 
+  if ( id < 0 || id >= ids.size() ) return -1;
+  return ids[id];
+}
+
+void renderTeX::attach( int id, QString source, QString preamb ) { 
+  QString key = contentKey( source, preamb );
+  int i = itemByKey.value( key, -1 );
+  if ( i < 0 ) { 
+    renderItem *it = new renderItem( source, preamb );
+    connect( it, SIGNAL(renderingReady(int)), this, SLOT(renderingFinished(int)) );
+    if ( available_items.size() > 0 ) { 
+      i = available_items.pop();
+      items[i] = it;
+      refCount[i] = 0;
+      itemKeys[i] = key;
+    } else { 
+      items.append( it );
+      refCount.append( 0 );
+      itemKeys.append( key );
+      i = items.size()-1;
+    }
+    itemByKey.insert( key, i );
+  }
+  refCount[i]++;
+  ids[id] = i;
+  idsOf.insert( i, id );
+}
+
+void renderTeX::detach( int id ) { 
+  int i = index( id );
+  if ( i < 0 ) return;
+  ids[id] = -1;
+  idsOf.remove( i, id );
+  if ( --refCount[i] > 0 ) return;
+  itemByKey.remove( itemKeys[i] );
+  delete items[i];
+  items[i] = NULL;
+  shown.remove( i ); // the renderings stay in the cache (they are keyed by the content)
+  batchQueue.remove( i );
+  wantedZoom.remove( i );
+  wantedFormat.remove( i );
+  sizeHints.remove( i );
+  available_items.push( i );
+}
+
 /* This method should always succeed */
 int renderTeX::addItem( QString source, QString preamb ) { 
   if ( preamb == "" ) preamb = preambule;
-  renderItem *it = new renderItem( source, preamb );
   int id;
-  if ( available_ids.size() > 0 ) { 
-    id = available_ids.pop();
-    items[id] = it;
-  } else {
-    items.append( it );
-    id = items.size()-1;
+  if ( available_ids.size() > 0 ) id = available_ids.pop();
+  else { 
+    ids.append( -1 );
+    id = ids.size()-1;
   }
+  attach( id, source, preamb );
   return id;
 }
 
 void renderTeX::setItem( int itemID, QString source, QString preamb ) {
+  Q_ASSERT( 0 <= itemID );
   if ( preamb == "" ) preamb = preambule;
-  renderItem *it = new renderItem( source, preamb );
-  if ( items.size() <= itemID ) items.resize( itemID + 10 );
-  else {
-    deleteItem( itemID );
-    available_ids.pop();
+  while( ids.size() <= itemID ) { // the skipped ids can be given out by addItem
+    ids.append( -1 );
+    if ( ids.size()-1 < itemID ) available_ids.push( ids.size()-1 );
   }
-  items[itemID] = it;
+  int free = available_ids.indexOf( itemID );
+  if ( free > -1 ) available_ids.remove( free );
+  detach( itemID );
+  attach( itemID, source, preamb );
 }
   
 
 void renderTeX::deleteItem( int item ) { 
-  Q_ASSERT( 0 <= item && item < items.size() );
-  delete items[item];
-  renderCache.remove( item );
-  items[item]=NULL;
+  Q_ASSERT( index( item ) >= 0 );
+  cancelPreview( item );
+  detach( item );
   available_ids.push(item);
 }
 
 void renderTeX::updateItem( int item, QString source, QString preamb ) { 
-  Q_ASSERT( 0 <= item && item < items.size() && items[item] );
+  Q_ASSERT( index( item ) >= 0 );
   if ( preamb == "" ) preamb = preambule;
-  connect( items[item], SIGNAL(renderingReady(int)), this, SIGNAL(itemReady(int)) );
-  items[item]->updateItem( source, preamb, item );
-  renderCache.remove( item );
+  int i = ids[item];
+  int sizeHint = sizeHints.value( i, 50 ); // the size hint is part of the compiled source, so it is kept
+  QString key = contentKey( source, preamb );
+  if ( refCount[i] == 1 && itemByKey.value( key, i ) == i ) { 
+    // nobody else uses the item, so it is updated in place (a running
+    // compilation is restarted and the old rendering is shown until the new one is ready)
+    itemByKey.remove( itemKeys[i] );
+    itemKeys[i] = key;
+    itemByKey.insert( key, i );
+    items[i]->updateItem( source, preamb, i, false, sizeHint );
+    return;
+  }
+  detach( item );
+  attach( item, source, preamb );
+  i = ids[item];
+  if ( items[i]->isReady() ) QMetaObject::invokeMethod( this, "idReady", Qt::QueuedConnection, Q_ARG( int, item ) );
+  else if ( items[i]->needsRendering() ) preRenderIndex( i, false, sizeHint ); // otherwise it is being compiled for another id
+}
+
+void renderTeX::previewItem( int item, QString source, QString preamb ) { 
+  Q_ASSERT( 0 <= item );
+  if ( preamb == "" ) preamb = preambule;
+  if ( index( item ) < 0 ) setItem( item, "", preamb );
+  previewSources.insert( item, qMakePair( source, preamb ) );
+  QTimer *timer = previewTimers.value( item );
+  if ( ! timer ) { 
+    timer = new QTimer( this );
+    timer->setSingleShot( true );
+    connect( timer, SIGNAL( timeout() ), previewMapper, SLOT( map() ) );
+    previewMapper->setMapping( timer, item );
+    previewTimers.insert( item, timer );
+  }
+  timer->start( previewDelay ); // restarts a running timer (i.e. the trailing edge of the edits counts)
 }
 
-QPixmap renderTeX::render( int item, bool format_inline, qreal zoom, int sizeHint ) { 
-  Q_ASSERT( 0 <= item && item < items.size() && items[item] );
-  struct cachedPage *pg = renderCache.object( item );
+void renderTeX::previewTimeout( int item ) { 
+  if ( ! previewSources.contains( item ) || index( item ) < 0 ) return;
+  QPair<QString, QString> src = previewSources.take( item );
+  updateItem( item, src.first, src.second );
+}
+
+void renderTeX::cancelPreview( int item ) { 
+  previewSources.remove( item );
+  QTimer *timer = previewTimers.take( item );
+  if ( timer ) { 
+    previewMapper->removeMappings( timer );
+    delete timer;
+  }
+}
+
+QPixmap renderTeX::render( int id, bool format_inline, qreal zoom, int sizeHint ) { 
+  Q_ASSERT( index( id ) >= 0 );
+  if ( ! compileJob::pathsOK() ) { 
+    qWarning() << "renderTeX::render: PdfLaTex not found.";
+    return QPixmap();
+  }
+  int item = ids[id];
+  renderItem *it = items[item];
+  QRectF bBox = it->getBBox();
+  QSize sz( qMax( 1, qRound(bBox.width()*zoom) ), qMax( 1, qRound(bBox.height()*zoom) ) );
+  struct cachedPage *pg = cached( item, format_inline, zoom );
   if ( pg ) { 
-    if ( pg->format_inline == format_inline && pg->zoom == zoom ) return pg->pix;
-    if ( compileJob::pathsOK() ) { 
-      pg->pix = items[item]->render( zoom, format_inline, sizeHint );
-      pg->format_inline = format_inline;
-      pg->zoom = zoom;
-      return pg->pix;
-    } else { 
-      qWarning() << "renderTeX::render: PdfLaTex or GhostScript not found.";
-      return QPixmap();
-    }
-  } else { 
-    if ( compileJob::pathsOK() ) { 
-      QPixmap ret = items[item]->render( zoom, format_inline, sizeHint );
-      int cost = (int) (items[item]->size()*zoom);
-      if ( cost >= renderCache.maxCost() ) { 
-	qWarning() << "Warning, render cache too small, result will not be cached !!!";
-	return ret;
-      } else {
-	pg = new cachedPage;
-        pg->pix = ret;
-	pg->format_inline = format_inline;
-	pg->zoom = zoom;
-	renderCache.insert( item, pg, (int) (items[item]->size()*zoom) );
-	return ret;
+    hits++;
+    return scaledRendering( pg, zoom );
+  }
+  misses++;
+  // the rendering of the previous source (or at another zoom) is shown until the right one is rasterized
+  pg = renderCache.object( shown.value( item ) );
+
+  wantedZoom.insert( item, zoom );
+  wantedFormat.insert( item, format_inline );
+  if ( ! it->isReady() ) { // rasterizing starts when the compilation is finished (see renderingFinished)
+    if ( it->needsRendering() ) { 
+      QFuture<QString> version = compileJob::engineVersion();
+      if ( version.isFinished() ) preRenderIndex( item, format_inline, sizeHint );
+      else { // probing the cache would wait for the version, paint must not
+        sizeHints.insert( item, sizeHint );
+        waitingForEngine.insert( item );
+        if ( ! engineWatcher->isRunning() ) engineWatcher->setFuture( version );
       }
-    } else { 
-      qWarning() << "renderTeX::render: PdfLaTex or GhostScript not found.";
-      return QPixmap();
     }
+    it->prioritize(); // somebody wants to see it, so it should not wait in the queue
+    return pg ? scaledRendering( pg, zoom ) : QPixmap();
+  }
+  if ( ! rasterizing.contains( item ) ) startRasterizing( item );
+
+  if ( pg ) return scaledRendering( pg, zoom );
+  QPixmap placeholder( sz );
+  placeholder.fill( Qt::transparent );
+  return placeholder;
+}
+
+void renderTeX::engineResolved() { 
+  foreach( int item, waitingForEngine ) { 
+    if ( item < items.size() && items[item] && items[item]->needsRendering() ) preRenderIndex( item, wantedFormat.value( item, false ), sizeHints.value( item, 50 ) );
+  }
+  waitingForEngine.clear();
+}
+
+bool renderTeX::isRendered( int id, bool format_inline, qreal zoom ) { 
+  Q_ASSERT( index( id ) >= 0 );
+  return cached( ids[id], format_inline, zoom );
+}
+
+QString renderTeX::cacheKey( const QString &content, bool format_inline, qreal zoom ) { 
+  return content+( format_inline ? ":i:" : ":b:" )+QString::number( zoom );
+}
+
+int renderTeX::cacheCost( struct cachedPage *pg ) { 
+  qint64 bytes = 0;
+  foreach( QPixmap level, pg->mipmaps ) bytes += (qint64) level.width()*level.height()*level.depth()/8;
+  bytes += (qint64) pg->mipmaps[0].width()*pg->mipmaps[0].height()*pg->mipmaps[0].depth()/8; // the scaled pixmap is at most as large as mipmaps[0]
+  return qMax( (qint64) 1, bytes/1024 );
+}
+
+/* A rendering at most 8 times larger than wanted is still used */
+struct renderTeX::cachedPage *renderTeX::cached( int item, bool format_inline, qreal zoom ) { 
+  qreal bucket = mipmapZoom;
+  while( bucket < zoom ) bucket *= 2;
+  for( int i = 0; i < 4; i++, bucket *= 2 ) { 
+    QString key = cacheKey( itemKeys[item], format_inline, bucket );
+    struct cachedPage *pg = renderCache.object( key );
+    if ( pg ) { 
+      shown.insert( item, key );
+      return pg;
+    }
+  }
+  return NULL;
+}
+
+QPixmap renderTeX::scaledRendering( struct cachedPage *pg, qreal zoom ) { 
+  if ( pg->scaledZoom == zoom ) return pg->scaled;
+  // scaled as a whole, so that the aspect ratio is kept and the pixmap stays aligned with the bounding box
+  QSize sz = pg->mipmaps[0].size()*(zoom/pg->zoom);
+  int level = 0; // the smallest level which is at least as large as wanted
+  while( level+1 < pg->mipmaps.size() && pg->zoom/(1 << (level+1)) >= zoom ) level++;
+  pg->scaled = pg->mipmaps[level].scaled( sz, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+  pg->scaledZoom = zoom;
+  return pg->scaled;
+}
+
+QList<QImage> renderTeX::rasterizeMipmaps( QString pdfFile, int page, QRectF bBox, qreal zoom ) { 
+  QImage level = renderItem::rasterize( pdfFile, page, bBox, zoom );
+  if ( level.isNull() ) return QList<QImage>();
+  // without the 1 pixel margin, the levels cover exactly the bounding box (the margin would be scaled with it)
+  if ( level.width() > 2 && level.height() > 2 ) level = level.copy( 1, 1, level.width()-2, level.height()-2 );
+  return mipmaps( level );
+}
+
+QList<QImage> renderTeX::mipmaps( QImage level ) { 
+  QList<QImage> ret;
+  ret.append( level );
+  while( level.width() >= 16 && level.height() >= 16 ) { 
+    level = level.scaled( level.width()/2, level.height()/2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    ret.append( level );
+  }
+  return ret;
+}
+
+void renderTeX::startRasterizing( int item ) { 
+  renderItem *it = items[item];
+  struct rasterJob job;
+  job.item = item;
+  job.key = itemKeys[item];
+  job.zoom = mipmapZoom;
+  while( job.zoom < wantedZoom.value( item, 1 ) ) job.zoom *= 2;
+  job.format_inline = wantedFormat.value( item, false );
+  job.pdfFile = it->getPDFFileName();
+  job.page = it->getPDFPage();
+  QFutureWatcher<QList<QImage> > *watcher = new QFutureWatcher<QList<QImage> >( this );
+  connect( watcher, SIGNAL( finished() ), this, SLOT( rasterFinished() ) );
+  rasterJobs.insert( watcher, job );
+  rasterizing.insert( item );
+  watcher->setFuture( QtConcurrent::run( rasterizeMipmaps, job.pdfFile, job.page, it->getBBox(), job.zoom ) );
+}
+
+void renderTeX::rasterFinished() { 
+  QFutureWatcher<QList<QImage> > *watcher = static_cast<QFutureWatcher<QList<QImage> > *>( sender() );
+  if ( ! rasterJobs.contains( watcher ) ) return;
+  struct rasterJob job = rasterJobs.take( watcher );
+  QList<QImage> levels = watcher->result();
+  watcher->deleteLater();
+  rasterizing.remove( job.item );
+
+  // the rendering belongs to the content, so it is cached even if the item changed in the meantime
+  QString key = cacheKey( job.key, job.format_inline, job.zoom );
+  if ( ! levels.isEmpty() ) { 
+    struct cachedPage *pg = new cachedPage;
+    foreach( QImage level, levels ) pg->mipmaps.append( QPixmap::fromImage( level ) );
+    pg->zoom = job.zoom;
+    pg->scaledZoom = -1;
+    int cost = cacheCost( pg );
+    if ( cost >= renderCache.maxCost() ) { 
+      qWarning() << "Warning, render cache too small, result will not be cached !!!";
+      delete pg;
+    } else renderCache.insert( key, pg, cost );
+  }
+
+  int item = job.item;
+  if ( item >= items.size() || ! items[item] || ! items[item]->isReady() ) return; // deleted or being recompiled
+  if ( itemKeys[item] != job.key || items[item]->getPDFFileName() != job.pdfFile || items[item]->getPDFPage() != job.page ) { // recompiled in the meantime
+    if ( wantedZoom.contains( item ) ) startRasterizing( item );
+    return;
   }
+  if ( renderCache.contains( key ) ) shown.insert( item, key );
+  // a larger zoom could have been asked for while rasterizing
+  if ( wantedZoom.value( item, job.zoom ) > job.zoom || wantedFormat.value( item, job.format_inline ) != job.format_inline ) startRasterizing( item );
+  emitReady( item );
 }
 
-void renderTeX::preRender( int item, bool format_inline, int sizeHint ) { 
-  Q_ASSERT( 0 <= item && item < items.size() && items[item] );
+void renderTeX::preRender( int id, bool format_inline, int sizeHint ) { 
+  Q_ASSERT( index( id ) >= 0 );
+  if ( items[ids[id]]->isReady() ) { // e.g. compiled for another id
+    QMetaObject::invokeMethod( this, "idReady", Qt::QueuedConnection, Q_ARG( int, id ) );
+    return;
+  }
+  preRenderIndex( ids[id], format_inline, sizeHint );
+}
+
+void renderTeX::preRenderIndex( int item, bool format_inline, int sizeHint ) { 
+  sizeHints.insert( item, sizeHint );
   if ( compileJob::pathsOK() ) { 
-    connect( items[item], SIGNAL(renderingReady(int)), this, SIGNAL(itemReady(int)) );
-    items[item]->preRender( item, format_inline, sizeHint );
+    if ( items[item]->isCached( sizeHint ) ) items[item]->preRender( item, format_inline, sizeHint );
+    else { // wait for the other preRender calls made in this pass of the event loop
+      if ( batchQueue.isEmpty() ) QTimer::singleShot( 0, this, SLOT( startBatches() ) );
+      batchQueue.insert( item, sizeHint );
+    }
   } else { 
-    qWarning() << "renderTeX::render: PdfLaTex or GhostScript not found.";
+    qWarning() << "renderTeX::render: PdfLaTex not found.";
   }
 }
 
+void renderTeX::prioritize( int item ) { 
+  if ( index( item ) < 0 ) return;
+  items[ids[item]]->prioritize();
+}
+
 QString renderTeX::getPDF(int item) {
-  Q_ASSERT( 0 <= item && item < items.size() && items[item] );
-  return items[item]->getPDFFileName();
+  Q_ASSERT( index( item ) >= 0 );
+  return items[ids[item]]->getPDFFileName();
+}
+
+int renderTeX::getPDFPage(int item) {
+  Q_ASSERT( index( item ) >= 0 );
+  return items[ids[item]]->getPDFPage();
 }
 
 QRectF renderTeX::getBBox(int item) {
-  Q_ASSERT( 0 <= item && item < items.size() && items[item] );
-  return items[item]->getBBox();
+  Q_ASSERT( index( item ) >= 0 );
+  return items[ids[item]]->getBBox();
 }
 
 
 
+void renderTeX::startBatches() { 
+  QMap<QString, QList<int> > groups;
+  QMap<int, int>::const_iterator it;
+  for( it = batchQueue.constBegin(); it != batchQueue.constEnd(); ++it ) { 
+    if ( it.key() >= items.size() || ! items[it.key()] || ! items[it.key()]->needsRendering() ) continue; // e.g. rendered in the meantime
+    groups[items[it.key()]->getPreambule()].append( it.key() );
+  }
+
+  // split the groups so that all the scheduler's slots get some work
+  int jobs = compileScheduler::instance()->maxJobs();
+  foreach( QList<int> group, groups ) { 
+    int perBatch = qBound( 1, (group.size()+jobs-1)/jobs, maxBatchSize );
+    for( int first = 0; first < group.size(); first += perBatch ) { 
+      QList<int> part = group.mid( first, perBatch );
+      if ( part.size() == 1 ) { 
+        items[part[0]]->preRender( part[0], false, batchQueue.value( part[0] ) );
+        continue;
+      }
+      renderBatch *batch = new renderBatch( items[part[0]]->getPreambule() );
+      foreach( int i, part ) items[i]->joinBatch( batch, i, batchQueue.value( i ) );
+      batch->start();
+    }
+  }
+  batchQueue.clear();
+}
+
 void renderTeX::renderingFinished( int i ) { 
   Q_ASSERT( 0 <= i && i < items.size() && items[i] );
-  emit itemReady( i );
+  if ( wantedZoom.contains( i ) && ! rasterizing.contains( i ) && ! cached( i, wantedFormat.value( i ), wantedZoom.value( i ) ) ) startRasterizing( i );
+  emitReady( i );
+}
+
+void renderTeX::idReady( int id ) { 
+  int i = index( id );
+  if ( i > -1 && items[i]->isReady() ) emit itemReady( id );
+}
+
+void renderTeX::emitReady( int i ) { 
+  // a receiver can delete (or even reuse) the other ids of the item
+  foreach( int id, idsOf.values( i ) ) if ( index( id ) == i ) emit itemReady( id );
 }
  
 
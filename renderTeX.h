@@ -30,44 +30,176 @@
 #include <QtCore/QVector>
 #include <QtCore/QStack>
 #include <QtCore/QCache>
+#include <QtCore/QMap>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QPair>
+#include <QtGui/QImage>
 #include <QtCore/QString>
 #include <QtGui/QPixmap>
 
 class renderItem;
+class QTimer;
+class QSignalMapper;
 
+/* renderTeX --- renders LaTeX snippets (items) to pixmaps. There is one
+ *               instance shared by all the tools (see instance()). An
+ *               item id (returned by addItem) is a reference to a
+ *               renderItem, which is shared by all the ids with the same
+ *               source and preambule (i.e. a formula used by several
+ *               annotations is compiled and rasterized once) and deleted
+ *               when its last id is deleted. The private methods work
+ *               with the indices of the shared renderItems, the public
+ *               ones with the ids.
+ */
 class renderTeX : public QObject { 
   Q_OBJECT
 	private:
+		/* The item is rasterized once at a high zoom and downscaled by halves
+		 * (a mipmap), any other zoom is drawn by scaling the closest larger level,
+		 * so that zooming does not need Poppler */
 		struct cachedPage { 
-		  bool format_inline;
-		  qreal zoom;
-		  QPixmap pix;
+		  qreal zoom; // the zoom of mipmaps[0]
+		  QList<QPixmap> mipmaps; // mipmaps[i] is rendered at zoom/2^i
+		  qreal scaledZoom; // the last scaled pixmap (paint asks for the same zoom repeatedly)
+		  QPixmap scaled;
 		};
-		static QCache<int, struct cachedPage> renderCache;
-		QVector<renderItem*> items;
+
+		/* The renderings are keyed by the content of the item, the zoom bucket
+		 * (mipmaps[0] is rendered at mipmapZoom*2^k) and format_inline, so
+		 * e.g. a tooltip and an inline rendering of an item do not evict each
+		 * other and an item deleted and added again is not rasterized again.
+		 * The cost of an entry is its size in kilobytes (see cacheCost), the
+		 * budget is given by the tex_pixmap_cache configuration key (in MB). */
+		QCache<QString, struct cachedPage> renderCache;
+		QHash<int, QString> shown; // index -> the key of its last rendering (possibly of a previous source)
+		int hits, misses;
+		static QString cacheKey( const QString &content, bool format_inline, qreal zoom );
+		static int cacheCost( struct cachedPage *pg );
+		/* The cached rendering of the item good for @zoom (i.e. of a bucket at least @zoom) */
+		struct cachedPage *cached( int index, bool format_inline, qreal zoom );
+
+		QVector<renderItem*> items; // the shared items (NULL if free)
+		QVector<int> refCount;
+		QVector<QString> itemKeys;
+		QHash<QString, int> itemByKey; // content hash -> index
+		QStack<int> available_items;
+
+		QVector<int> ids; // id -> index into items (-1 if the id is free)
+		QMultiHash<int, int> idsOf; // index -> ids
 		QStack<int> available_ids;
 
+		static QString contentKey( const QString &source, const QString &preamb );
+		int index( int id ) const;
+		/* Points @id to the item with @source and @preamb (creating it if needed) */
+		void attach( int id, QString source, QString preamb );
+		void detach( int id );
+		void emitReady( int index );
+		void preRenderIndex( int index, bool format_inline, int sizeHint );
+
 		QString preambule;
 
+		/* The items waiting for startBatches (item -> sizeHint) */
+		QMap<int, int> batchQueue;
+
+		/* Rasterizing runs in the global thread pool, at most one
+		 * rasterization per item at a time */
+		struct rasterJob { 
+		  int item;
+		  QString key; // the content of the item when the job started
+		  bool format_inline;
+		  qreal zoom;
+		  QString pdfFile;
+		  int page;
+		};
+		QHash<QFutureWatcher<QList<QImage> > *, struct rasterJob> rasterJobs;
+		QSet<int> rasterizing;
+		QHash<int, qreal> wantedZoom; // the zoom render was last asked for
+		QHash<int, bool> wantedFormat;
+		QHash<int, int> sizeHints; // the sizeHint the item was last compiled with
+
+		/* The items render was asked for before the latex version (needed by
+		 * the cache keys) was known, preRendered by engineResolved */
+		QSet<int> waitingForEngine;
+		QFutureWatcher<QString> *engineWatcher;
+		void startRasterizing( int item );
+		static QPixmap scaledRendering( struct cachedPage *pg, qreal zoom );
+
+		/* Rasterizes the item (see renderItem::rasterize) and computes the mipmap
+		 * levels, runs in a worker thread */
+		static QList<QImage> rasterizeMipmaps( QString pdfFile, int page, QRectF bBox, qreal zoom );
+
+		/* The typed preview (see previewItem) */
+		int previewDelay;
+		QHash<int, QTimer *> previewTimers;
+		QHash<int, QPair<QString, QString> > previewSources; // item -> (source, preambule)
+		QSignalMapper *previewMapper;
+		void cancelPreview( int item );
+
 	protected slots:
 		void renderingFinished( int i );
+		/* Emits itemReady( @id ) if its (shared) item is ready */
+		void idReady( int id );
+		void rasterFinished();
+		void previewTimeout( int item );
+		void engineResolved();
+
+		/* Compiles the items preRendered since the last call,
+		 * grouped by preambule into renderBatches */
+		void startBatches();
 
 	public:
 		renderTeX( QString preamb="" );
+		~renderTeX();
+
+		/* The renderer shared by all the tools */
+		static renderTeX *instance();
 
 		void setPaths( QString pdfLaTeX, QString ghostScript );
 		void setPreambule( QString preambule );
 
 		/* This method should always succeed */
 		int addItem( QString source, QString preambule = "" );
+		/* Changes the source of @itemID (without compiling it) */
 		void setItem( int itemID, QString source, QString preambule = "" );
+		/* Changes the source of @item and compiles it */
 		void updateItem( int item, QString source, QString preambule = "" );
 		void deleteItem( int item );
-		// sizeHint is the wanted width in millimeters
+
+		/* Typed preview: updates the @item to @source once no other call for
+		 * it came in the last previewDelay() ms, so that typing does not start
+		 * a compilation for every keystroke. A compilation superseded by a newer
+		 * source is restarted, and since the results are cached by their content
+		 * (see teXCache), undoing an edit does not compile again. */
+		void previewItem( int item, QString source, QString preambule = "" );
+		/* In milliseconds, can be set by the tex_preview_delay configuration key */
+		int getPreviewDelay() const { return previewDelay; };
+		void setPreviewDelay( int ms ) { previewDelay = ms; };
+		/* Never blocks. Returns the rendering of @item at @zoom if it is available,
+		 * otherwise the best available one (scaled to the right size) or an empty
+		 * placeholder, and starts compiling/rasterizing the item; itemReady is emitted
+		 * when a better rendering exists. sizeHint is the wanted width in millimeters */
 		QPixmap render( int item, bool format_inline = false, qreal zoom = 1, int sizeHint = 50 );
+		/* True if render( @item, @format_inline, @zoom ) would return the final rendering */
+		bool isRendered( int item, bool format_inline = false, qreal zoom = 1 );
 		void preRender( int item, bool format_inline = false, int sizeHint = 50 );
+		/* Moves the compilation of @item (if it is queued) to the front
+		 * of the compileScheduler queue, e.g. because it is in view */
+		void prioritize( int item );
 		QString getPDF( int item );
+		/* The page of getPDF( item ) which holds the item */
+		int getPDFPage( int item );
 		QRectF getBBox( int item );
+
+		/* Returns @level followed by its downscaled halves (until a side is
+		 * less than 16 pixels), i.e. the mipmap levels of a rasterized item */
+		static QList<QImage> mipmaps( QImage level );
+
+		/* The render calls which found (did not find) the wanted rendering in the cache */
+		int cacheHits() const { return hits; };
+		int cacheMisses() const { return misses; };
+		void resetCacheStats() { hits = misses = 0; };
 	signals:
 		void itemReady( int item );
 
@@ -30,9 +30,10 @@
 #include "search.h"
 #include "pdfScene.h"
 #include "sceneLayer.h"
-#include "hiliteItem.h"
+#include "matchOverlay.h"
 
 #include <QtCore/QDebug>
+#include <QtCore/QtAlgorithms>
 
 #include <poppler-qt4.h>
 
@@ -40,13 +41,15 @@ using namespace Poppler;
 
 
 searcher::searcher( pdfScene *SC ):
-	scene(SC)
+	scene(SC), cMatch(0), fuzzyWatcher(NULL)
 {
   searchLayer = scene->addLayer();
   searchLayer->setZValue(30);
 }
 
 searcher::~searcher() { 
+  cancelFuzzySearch();
+  clearTerms();
   scene->removeLayer( searchLayer );
 }
 
@@ -58,18 +61,22 @@ int searcher::numOfMatches( int n ) {
   return matches.size();
 }
 
+/* One overlay item per page, holding all the matches on that page */
 void searcher::hilightMatches() { 
-  pageSelections pgSel;
-  QPointF curPagePos;
-  hiliteItem *hi;
   foreach( pageSelections pageMatches, matches )  {
-    curPagePos = scene->topLeftPage( pageMatches.pageNum );
-    foreach( QList<TextBox *> match, pageMatches.selections ) { 
-      hi = new hiliteItem( curPagePos, match );
-      searchLayer->addItem( hi );
-    }
+    searchLayer->addItem( new matchOverlayItem( scene->topLeftPage( pageMatches.pageNum ), pageMatches.selections ) );
   }
-  dynamic_cast<hiliteItem*>(searchLayer->currentItem())->setActive();
+  cMatch = 0;
+  currentOverlay()->setActive( cMatch );
+}
+
+matchOverlayItem *searcher::currentOverlay() { 
+  return static_cast<matchOverlayItem*>( searchLayer->currentItem() );
+}
+
+QRectF searcher::currentMatchRect() { 
+  matchOverlayItem *overlay = currentOverlay();
+  return overlay->mapRectToScene( overlay->matchRect( cMatch ) );
 }
 
 
@@ -80,6 +87,7 @@ void searcher::hilightMatches() {
  * the current matches and delete all those which
  * do not start with ameri. */
 void searcher::searchTermChanged( QString text ) {
+  cancelFuzzySearch();
   searchTerm = text;
   if ( text == "" ) { 
     clearSearch();
@@ -92,7 +100,7 @@ void searcher::searchTermChanged( QString text ) {
   searchLayer->clear();
   if ( matches.size() > 0 ) { 
     hilightMatches();
-    emit currentMatchPosition( searchLayer->currentItem()->sceneBoundingRect() );
+    emit currentMatchPosition( currentMatchRect() );
     emit matchFound( matches.size() );
   } else { 
     emit matchNotFound();
@@ -100,18 +108,137 @@ void searcher::searchTermChanged( QString text ) {
 }
 
 void searcher::clearSearch() {
+  cancelFuzzySearch();
   searchTerm="";
   searchLayer->clear();
   matches.clear();
   emit clear();
 }
 
+/* The watcher is thrown away, so that results of a cancelled
+ * search which are still in the event queue are not delivered.
+ * The pages being searched are waited for, since the search reads
+ * the scene's text layers (which the caller may delete) */
+void searcher::cancelFuzzySearch() { 
+  if ( ! fuzzyWatcher ) return;
+  fuzzyWatcher->disconnect( this );
+  fuzzyWatcher->cancel();
+  fuzzyWatcher->waitForFinished();
+  fuzzyWatcher->deleteLater();
+  fuzzyWatcher = NULL;
+}
+
+void searcher::searchFuzzy( QString text, int maxErrors ) { 
+  clearSearch();
+  if ( text == "" ) return;
+  searchTerm = text;
+  fuzzyWatcher = new QFutureWatcher<pageSelections>( this );
+  connect( fuzzyWatcher, SIGNAL( resultsReadyAt(int,int) ), this, SLOT( fuzzyResultsReady(int,int) ) );
+  connect( fuzzyWatcher, SIGNAL( finished() ), this, SLOT( fuzzyFinished() ) );
+  fuzzyWatcher->setFuture( scene->findTextFuzzy( text, maxErrors ) );
+}
+
+void searcher::fuzzyResultsReady( int begin, int end ) { 
+  bool first = ( matches.size() == 0 );
+  pageSelections pageMatches;
+  for( int i = begin; i < end; ++i ) { 
+    pageMatches = fuzzyWatcher->resultAt( i );
+    if ( pageMatches.selections.size() == 0 ) continue;
+    matches.append( pageMatches );
+    searchLayer->addItem( new matchOverlayItem( scene->topLeftPage( pageMatches.pageNum ), pageMatches.selections ) );
+  }
+  if ( first && matches.size() > 0 ) { 
+    cMatch = 0;
+    currentOverlay()->setActive( cMatch );
+    emit currentMatchPosition( currentMatchRect() );
+    emit matchFound( matches.size() );
+  }
+}
+
+namespace { 
+  /* Pages are ranked by their best match, which is the first one */
+  bool closerPage( const pageSelections &a, const pageSelections &b ) { 
+    if ( a.distances.first() != b.distances.first() ) return a.distances.first() < b.distances.first();
+    return a.pageNum < b.pageNum;
+  }
+}
+
+void searcher::fuzzyFinished() { 
+  fuzzyWatcher->deleteLater();
+  fuzzyWatcher = NULL;
+  if ( matches.size() == 0 ) { 
+    emit matchNotFound();
+    return;
+  }
+  qSort( matches.begin(), matches.end(), closerPage );
+  searchLayer->clear();
+  hilightMatches();
+  emit currentMatchPosition( currentMatchRect() );
+  emit matchFound( matches.size() );
+}
+
+int searcher::numOfTermMatches( int term ) const { 
+  if ( term < 0 || term >= termMatches.size() ) return 0;
+  return termMatches[term].numOfMatches;
+}
+
+/* Each term gets its own layer (and colour), the colours are
+ * spread evenly around the hue circle */
+void searcher::hilightTermMatches() { 
+  sceneLayer *layer;
+  matchOverlayItem *overlay;
+  QColor col;
+  int numTerms = termMatches.size();
+  for( int t = 0; t < numTerms; ++t ) { 
+    layer = scene->addLayer();
+    layer->setZValue( 29 );
+    termLayers.append( layer );
+    col = QColor::fromHsv( (t*360)/numTerms, 255, 255, 100 );
+    foreach( pageSelections pageMatches, termMatches[t].pages ) { 
+      overlay = new matchOverlayItem( scene->topLeftPage( pageMatches.pageNum ), pageMatches.selections );
+      overlay->setColor( col );
+      layer->addItem( overlay );
+    }
+  }
+}
+
+void searcher::searchTerms( const QStringList &terms, Qt::CaseSensitivity cs ) { 
+  clearTerms();
+  termMatches = scene->findTerms( terms, cs );
+  hilightTermMatches();
+  int total = 0;
+  foreach( termSelections tsel, termMatches ) { 
+    emit termMatchCount( tsel.term, tsel.numOfMatches );
+    total += tsel.numOfMatches;
+  }
+  emit termsFound( total );
+}
+
+void searcher::clearTerms() { 
+  foreach( sceneLayer *layer, termLayers ) { 
+    layer->clear();
+    scene->removeLayer( layer );
+  }
+  termLayers.clear();
+  termMatches.clear();
+}
+
 void searcher::advanceMatch( int i ) { 
   if ( matches.size() > 0 ) { 
-    dynamic_cast<hiliteItem*>(searchLayer->currentItem())->setInactive();
-    searchLayer->advanceCurrentItem( i );
-    dynamic_cast<hiliteItem*>(searchLayer->currentItem())->setActive();
-    emit currentMatchPosition( searchLayer->currentItem()->sceneBoundingRect() );
+    int step = ( i < 0 ) ? -1 : 1;
+    currentOverlay()->setActive( -1 );
+    for( ; i != 0; i -= step ) { 
+      cMatch += step;
+      if ( cMatch >= currentOverlay()->numOfMatches() ) { 
+	searchLayer->advanceCurrentItem( 1 );
+	cMatch = 0;
+      } else if ( cMatch < 0 ) { 
+	searchLayer->advanceCurrentItem( -1 );
+	cMatch = currentOverlay()->numOfMatches()-1;
+      }
+    }
+    currentOverlay()->setActive( cMatch );
+    emit currentMatchPosition( currentMatchRect() );
   }
 }
 
@@ -28,22 +28,38 @@
 
 #include <QtCore/QRectF>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QFutureWatcher>
 
 #include "sceneLayer.h"
 #include "pdfScene.h"
 
+class matchOverlayItem;
+
 class searcher : public QObject {
   Q_OBJECT
 	private:
 	  pdfScene *scene;
 	  sceneLayer *searchLayer;
 	  int numberOfMatches, currentPage;
+	  int cMatch; // the current match within the current overlay (searchLayer->currentItem())
 	  QString searchTerm;
 
 	  QList<pageSelections> matches;
 
+	  // multi-term (watch-list) search, each term has its own layer
+	  QList<sceneLayer *> termLayers;
+	  QList<termSelections> termMatches;
+
+	  void hilightTermMatches();
+
+	  // fuzzy search runs in the background, the pages are shown as they are done
+	  QFutureWatcher<pageSelections> *fuzzyWatcher;
+	  void cancelFuzzySearch();
 
 	  void hilightMatches();
+	  matchOverlayItem *currentOverlay();
+	  QRectF currentMatchRect();
 	  void advanceMatch( int i = 1 );
 
 
@@ -51,21 +67,37 @@ class searcher : public QObject {
 	  searcher( pdfScene *scene );
 	  ~searcher();
 	  int numOfMatches( int n );
+	  int numOfTerms() const { return termMatches.size(); };
+	  int numOfTermMatches( int term ) const;
 
 	public slots:
 
 	  void searchTermChanged( QString text );
 	  void clearSearch();
 
+	  void searchTerms( const QStringList &terms, Qt::CaseSensitivity cs = Qt::CaseSensitive );
+	  void clearTerms();
+
+	  /* Approximate search allowing @maxErrors typos (see pdfScene::findTextFuzzy),
+	   * matchFound is emitted as soon as the first match is found and
+	   * again when the search is finished, at which point the matches are
+	   * ranked so that the closest ones come first. */
+	  void searchFuzzy( QString text, int maxErrors );
+
 	  void nextMatch();
 	  void prevMatch();
 
+	private slots:
+	  void fuzzyResultsReady( int begin, int end );
+	  void fuzzyFinished();
 
 	signals:
 	  void matchNotFound();
 	  void matchFound( int n );
 	  void clear();
           void currentMatchPosition( const QRectF &sceneRect );
+	  void termMatchCount( const QString &term, int n );
+	  void termsFound( int totalMatches );
 
 };
 
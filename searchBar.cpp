@@ -29,6 +29,8 @@
 #include <QtGui/QHBoxLayout>
 #include <QtGui/QLineEdit>
 #include <QtGui/QPushButton>
+#include <QtGui/QCheckBox>
+#include <QtGui/QSpinBox>
 #include <QtGui/QLabel>
 #include <QtGui/QAction>
 
@@ -37,13 +39,26 @@ searchBar::searchBar( QWidget *parent ) {
   edit = new QLineEdit( this );
   next = new QPushButton( "Next", this );
   prev = new QPushButton( "Prev", this );
+  termList = new QCheckBox( tr("Term list"), this );
+  termList->setToolTip( tr("Search for a comma separated list of terms at once (press Enter)") );
+  fuzzy = new QCheckBox( tr("Fuzzy"), this );
+  fuzzy->setToolTip( tr("Allow typos (e.g. in scanned documents)") );
+  maxErrors = new QSpinBox( this );
+  maxErrors->setRange( 1, 5 );
+  maxErrors->setToolTip( tr("The maximal number of typos") );
+  maxErrors->setEnabled( false );
+  matchCount = new QLabel( this );
   QHBoxLayout *layout = new QHBoxLayout;
   QLabel *findLabel = new QLabel( tr("Find") );
   QAction *hide = new QAction( this );
   hide->setShortcut( (QString) "Esc" );
   addAction( hide );
   connect( hide, SIGNAL( triggered() ), parent, SLOT( hideEditArea() ) );
-  connect( edit, SIGNAL( textChanged(const QString &) ), this, SIGNAL( textChanged(const QString &) ) );
+  connect( edit, SIGNAL( textChanged(const QString &) ), this, SLOT( editTextChanged(const QString &) ) );
+  connect( edit, SIGNAL( returnPressed() ), this, SLOT( editReturnPressed() ) );
+  connect( termList, SIGNAL( toggled(bool) ), this, SLOT( termListToggled(bool) ) );
+  connect( fuzzy, SIGNAL( toggled(bool) ), this, SLOT( fuzzyToggled(bool) ) );
+  connect( maxErrors, SIGNAL( valueChanged(int) ), this, SLOT( maxErrorsChanged(int) ) );
   connect( next, SIGNAL( clicked() ), this, SIGNAL( nextMatch() ) );
   connect( prev, SIGNAL( clicked() ), this, SIGNAL( prevMatch() ) );
 
@@ -52,15 +67,66 @@ searchBar::searchBar( QWidget *parent ) {
   layout->addWidget( edit );
   layout->addWidget( next );
   layout->addWidget( prev );
+  layout->addWidget( termList );
+  layout->addWidget( fuzzy );
+  layout->addWidget( maxErrors );
+  layout->addWidget( matchCount );
   setLayout( layout );
 }
 
+QStringList searchBar::terms() const { 
+  QStringList ret;
+  foreach( QString term, edit->text().split( ',', QString::SkipEmptyParts ) ) 
+    if ( term.trimmed() != "" ) ret.append( term.trimmed() );
+  return ret;
+}
+
+void searchBar::editTextChanged( const QString &text ) { 
+  if ( termList->isChecked() ) return;
+  if ( fuzzy->isChecked() ) emit fuzzyTextChanged( text, maxErrors->value() );
+  else emit textChanged( text );
+}
+
+void searchBar::editReturnPressed() { 
+  if ( termList->isChecked() ) emit termsChanged( terms() );
+}
+
+void searchBar::termListToggled( bool on ) { 
+  if ( on ) { // the search of the whole text is replaced by the terms
+    fuzzy->blockSignals( true ); // the modes exclude each other
+    fuzzy->setChecked( false );
+    fuzzy->blockSignals( false );
+    maxErrors->setEnabled( false );
+    emit textChanged( "" );
+    emit termsChanged( terms() );
+  } else { 
+    emit termsChanged( QStringList() );
+    editTextChanged( edit->text() );
+  }
+}
+
+void searchBar::fuzzyToggled( bool on ) { 
+  maxErrors->setEnabled( on );
+  if ( on && termList->isChecked() ) { 
+    termList->blockSignals( true );
+    termList->setChecked( false );
+    termList->blockSignals( false );
+    emit termsChanged( QStringList() );
+  }
+  editTextChanged( edit->text() ); // searched again in the new mode
+}
+
+void searchBar::maxErrorsChanged( int n ) { 
+  if ( fuzzy->isChecked() ) editTextChanged( edit->text() );
+}
+
 void searchBar::setText( QString text ) {
   edit->setText(text);
 }
 
 void searchBar::setNone() { 
   edit->setStyleSheet("background-color: white");
+  matchCount->clear();
 }
 void searchBar::setFound() {
   edit->setStyleSheet("background-color: #6EFF69");
@@ -71,6 +137,7 @@ void searchBar::setMissed() {
 }
 
 void searchBar::setNumOfMatches(int n) {
+  matchCount->setText( tr("%n match(es)", "", n) );
 }
 
 void searchBar::focus() { 
@@ -27,16 +27,39 @@
 */
 
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 #include <QtGui/QWidget>
 
 class QLineEdit;
 class QPushButton;
+class QCheckBox;
+class QLabel;
+class QSpinBox;
 
 class searchBar : public QWidget { 
   Q_OBJECT
 	private:
 	  QLineEdit *edit;
 	  QPushButton *next,*prev;
+	  QLabel *matchCount;
+
+	  /* In the term list mode the edit holds comma separated terms which
+	   * are searched for all at once (see searcher::searchTerms) when
+	   * Enter is pressed, instead of searching as the text is typed */
+	  QCheckBox *termList;
+	  QStringList terms() const;
+
+	  /* In the fuzzy mode the text is searched for allowing at most
+	   * maxErrors typos (see searcher::searchFuzzy) */
+	  QCheckBox *fuzzy;
+	  QSpinBox *maxErrors;
+
+	private slots:
+	  void editTextChanged( const QString &text );
+	  void editReturnPressed();
+	  void termListToggled( bool on );
+	  void fuzzyToggled( bool on );
+	  void maxErrorsChanged( int n );
 
 	public:
 		searchBar( QWidget *parent );
@@ -54,6 +77,8 @@ class searchBar : public QWidget {
 	signals:
 
 		void textChanged( QString text );
+		void termsChanged( QStringList terms );
+		void fuzzyTextChanged( QString text, int maxErrors );
 		void nextMatch();
 		void prevMatch();
 
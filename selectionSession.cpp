@@ -0,0 +1,159 @@
+/**  This file is part of project comment
+ *
+ *  File: selectionSession.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "selectionSession.h"
+#include "pdfScene.h"
+#include "pageTextLayer.h"
+
+#include <QtCore/QtAlgorithms>
+
+#include <string.h>
+
+#include <poppler-qt4.h>
+
+using namespace Poppler;
+
+QRectF selectionDelta::apply( QList<QRectF> &boxes, const QPointF &offset ) const { 
+  QRectF changed, br;
+  for( int i = 0; i < removeFront && ! boxes.isEmpty(); ++i ) changed |= boxes.takeFirst();
+  for( int i = 0; i < removeBack && ! boxes.isEmpty(); ++i ) changed |= boxes.takeLast();
+  for( int i = addFront.size()-1; i >= 0; --i ) { 
+    br = addFront[i].translated( -offset );
+    boxes.prepend( br );
+    changed |= br;
+  }
+  foreach( QRectF box, addBack ) { 
+    br = box.translated( -offset );
+    boxes.append( br );
+    changed |= br;
+  }
+  return changed;
+}
+
+selectionSession::selectionSession( pdfScene *SC, const QPointF &anchor ):
+	scene( SC ), first( 0 ), last( -1 )
+{
+  int numPages = scene->getNumPages(), total = 0;
+  pageTextLayer *layer;
+  pageStart.reserve( numPages+1 );
+  for( int i = 0; i < numPages; ++i ) { 
+    pageStart.append( total );
+    if ( ( layer = scene->getTextLayer( i ) ) ) total += layer->numOfWords();
+  }
+  pageStart.append( total );
+  anchorPage = scene->posToPage( anchor );
+  anchorWord = wordAt( anchor );
+  extentWord = anchorWord;
+}
+
+/* Returns the number of the word at @scenePos, or -1 if the page
+ * there has no text */
+int selectionSession::wordAt( const QPointF &scenePos ) { 
+  int pg = scene->posToPage( scenePos );
+  pageTextLayer *layer = scene->getTextLayer( pg );
+  if ( ! layer || layer->numOfWords() == 0 ) return -1;
+  return pageStart[pg] + layer->wordAt( scenePos - scene->topLeftPage( pg ) );
+}
+
+int selectionSession::pageOf( int word ) const { 
+  if ( word < 0 ) return 0;
+  // the last page starting at or before word (empty pages start at the same word as the next one)
+  return ( qUpperBound( pageStart.begin(), pageStart.end()-1, word ) - pageStart.begin() ) - 1;
+}
+
+void selectionSession::appendRects( QList<QRectF> &rects, int from, int to ) const { 
+  pageTextLayer *layer;
+  QPointF topLeft;
+  int lastPg = pageOf( to ), w;
+  for( int pg = pageOf( from ); pg <= lastPg; ++pg ) { 
+    if ( pageStart[pg] == pageStart[pg+1] ) continue;
+    layer = scene->getTextLayer( pg );
+    topLeft = scene->topLeftPage( pg );
+    w = qMax( from, pageStart[pg] );
+    for( ; w <= to && w < pageStart[pg+1]; ++w ) 
+      rects.append( layer->word( w - pageStart[pg] )->boundingBox().translated( topLeft ) );
+  }
+}
+
+bool selectionSession::extendTo( const QPointF &scenePos, selectionDelta *delta ) { 
+  if ( anchorWord < 0 ) return false;
+  int word = wordAt( scenePos );
+  if ( word < 0 ) return false; // a page without text, keep the last extent
+  extentWord = word;
+  int nFirst = qMin( anchorWord, extentWord ), nLast = qMax( anchorWord, extentWord );
+  if ( nFirst == first && nLast == last ) return false;
+  if ( delta ) { 
+    *delta = selectionDelta();
+    if ( isEmpty() ) appendRects( delta->addBack, nFirst, nLast );
+    else { 
+      // both the old and the new selection contain the anchor word, so they overlap
+      if ( nFirst < first ) appendRects( delta->addFront, nFirst, first-1 );
+      else delta->removeFront = nFirst - first;
+      if ( nLast > last ) appendRects( delta->addBack, last+1, nLast );
+      else delta->removeBack = last - nLast;
+    }
+  }
+  first = nFirst;
+  last = nLast;
+  return true;
+}
+
+QList<QRectF> selectionSession::rects() const { 
+  QList<QRectF> ret;
+  if ( ! isEmpty() ) appendRects( ret, first, last );
+  return ret;
+}
+
+/* The length of the result is computed first, so that the text
+ * is copied into a single buffer instead of growing a QString
+ * word by word */
+QString selectionSession::text() const { 
+  QString ret;
+  if ( isEmpty() ) return ret;
+  QVector<TextBox *> words;
+  words.reserve( numOfWords() );
+  int len = 0, lastPg = pageOf( last ), w;
+  pageTextLayer *layer;
+  for( int pg = pageOf( first ); pg <= lastPg; ++pg ) { 
+    if ( pageStart[pg] == pageStart[pg+1] ) continue;
+    layer = scene->getTextLayer( pg );
+    for( w = qMax( first, pageStart[pg] ); w <= last && w < pageStart[pg+1]; ++w ) { 
+      words.append( layer->word( w - pageStart[pg] ) );
+      len += words.last()->text().size() + 1;
+    }
+  }
+  ret.resize( len );
+  QChar *out = ret.data();
+  QString txt;
+  foreach( TextBox *box, words ) { 
+    txt = box->text();
+    memcpy( out, txt.unicode(), txt.size()*sizeof(QChar) );
+    out += txt.size();
+    *out++ = QLatin1Char(' ');
+  }
+  return ret;
+}
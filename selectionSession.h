@@ -0,0 +1,101 @@
+#ifndef _selectionSession_H
+#define _selectionSession_H
+
+/**  This file is part of comment
+*
+*  File: selectionSession.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QList>
+#include <QtCore/QVector>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtCore/QString>
+
+class pdfScene;
+
+/* selectionDelta --- the change of a selection after its free end
+ *                    moved. The word under the anchor is always
+ *                    selected, so the selection can only grow or
+ *                    shrink at its two ends.
+ */
+struct selectionDelta { 
+  int removeFront, removeBack; // number of words dropped from the start/end of the selection
+  QList<QRectF> addFront, addBack; // boxes of the words added to the start/end (reading order, scene coordinates)
+
+  selectionDelta(): removeFront(0), removeBack(0) {};
+  bool isEmpty() const { return removeFront == 0 && removeBack == 0 && addFront.isEmpty() && addBack.isEmpty(); };
+
+  /* Applies the delta to @boxes, a list of word bounding boxes in
+   * reading order. The added boxes are moved by -@offset (pass the
+   * scene position of the item, so that they end up in item coordinates).
+   * Returns the rectangle (in the same coordinates) covering all the
+   * added and removed boxes, i.e. the part which needs to be repainted. */
+  QRectF apply( QList<QRectF> &boxes, const QPointF &offset = QPointF(0,0) ) const;
+};
+
+/* selectionSession --- a text selection being dragged out by the user.
+ *                      The words of all the pages are numbered
+ *                      consecutively (in reading order) and the session
+ *                      remembers the anchor word and the current extent
+ *                      by their numbers, so that a selection may span
+ *                      several pages and a mouse move costs two binary
+ *                      searches and yields just the words which entered
+ *                      or left the selection.
+ */
+class selectionSession { 
+	private:
+		pdfScene *scene;
+		QVector<int> pageStart; // the number of the first word of each page (and the total number of words at the end)
+		int anchorWord, extentWord;
+		int anchorPage; // the page under the anchor (which can have no text)
+		int first, last; // the selected words, first > last if nothing is selected
+
+		int wordAt( const QPointF &scenePos );
+		int pageOf( int word ) const;
+		void appendRects( QList<QRectF> &rects, int from, int to ) const;
+
+	public:
+		/* Starts a selection at @anchor (scene coordinates) */
+		selectionSession( pdfScene *scene, const QPointF &anchor );
+
+		/* Moves the free end of the selection to @scenePos. Returns true
+		 * if the selection changed, in which case @delta (if not NULL)
+		 * holds the change. */
+		bool extendTo( const QPointF &scenePos, selectionDelta *delta = NULL );
+
+		/* The page of the anchor */
+		int pageNum() const { return anchorPage; };
+		int firstPage() const { return pageOf( first ); };
+		int lastPage() const { return pageOf( last ); };
+		bool isEmpty() const { return first > last; };
+		int numOfWords() const { return last - first + 1; };
+
+		/* The boxes of the selected words, in scene coordinates */
+		QList<QRectF> rects() const;
+
+		/* The text of the selected words, separated by spaces */
+		QString text() const;
+};
+
+#endif /* _selectionSession_H */
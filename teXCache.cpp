@@ -0,0 +1,159 @@
+/**  This file is part of project comment
+ *
+ *  File: teXCache.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "teXCache.h"
+#include "config.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QProcess>
+#include <QtCore/QTextStream>
+#include <QtCore/QtConcurrentRun>
+#include <QtCore/QDebug>
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <utime.h>
+
+QHash<QString, QFuture<QString> > teXCache::engineVersions;
+qint64 teXCache::totalSize = -1;
+QHash<QString, int> teXCache::pins;
+
+QString teXCache::dir() { 
+  return config().cacheDir( "tex" );
+}
+
+QString teXCache::queryVersion( QString latexPath ) { 
+  QProcess proc;
+  proc.start( latexPath, QStringList() << "--version" );
+  QString version = latexPath;
+  if ( proc.waitForFinished( 5000 ) ) version = QString( proc.readAllStandardOutput() ).section( '\n', 0, 0 );
+  return version;
+}
+
+QFuture<QString> teXCache::resolveEngine( const QString &latexPath ) { 
+  if ( ! engineVersions.contains( latexPath ) ) engineVersions.insert( latexPath, QtConcurrent::run( queryVersion, latexPath ) );
+  return engineVersions[latexPath];
+}
+
+QString teXCache::engineVersion( const QString &latexPath ) { 
+  resolveEngine( latexPath );
+  return engineVersions[latexPath].result();
+}
+
+QString teXCache::key( const QString &latexSource, const QString &latexPath ) { 
+  QCryptographicHash md5( QCryptographicHash::Md5 );
+  md5.addData( engineVersion( latexPath ).toUtf8() );
+  md5.addData( "\n", 1 );
+  md5.addData( latexSource.toUtf8() );
+  return QString( md5.result().toHex() );
+}
+
+void teXCache::touch( const QString &path ) { 
+  utime( QFile::encodeName( path ).constData(), NULL );
+}
+
+bool teXCache::lookup( const QString &key, QString &pdfPath, QList<QRectF> &bBoxes ) { 
+  QString base = dir()+"/"+key;
+  QFile bboxFile( base+".bbox" );
+  if ( ! QFile::exists( base+".pdf" ) || ! bboxFile.open( QIODevice::ReadOnly ) ) return false;
+  QTextStream in( &bboxFile );
+  qreal x, y, w, h;
+  bBoxes.clear();
+  while( true ) { 
+    in >> x >> y >> w >> h;
+    if ( in.status() != QTextStream::Ok ) break;
+    bBoxes.append( QRectF( x, y, w, h ) );
+  }
+  if ( bBoxes.isEmpty() ) return false;
+  pdfPath = base+".pdf";
+  touch( pdfPath );
+  return true;
+}
+
+QString teXCache::store( const QString &key, const QString &pdfFile, const QList<QRectF> &bBoxes ) { 
+  QString base = dir()+"/"+key;
+  if ( totalSize >= 0 ) totalSize -= QFileInfo( base+".pdf" ).size();
+  // the scratch directory is usually on another filesystem (in /dev/shm, see teXScratch),
+  // where QFile::rename copies the file, so the copy is made next to the entry first and
+  // then renamed in place, so that the entry never holds a partially written pdf
+  QFile::remove( base+".tmp" );
+  if ( ! QFile::rename( pdfFile, base+".tmp" ) || rename( QFile::encodeName( base+".tmp" ).constData(), QFile::encodeName( base+".pdf" ).constData() ) != 0 ) { 
+    qWarning() << "teXCache: Cannot store" << pdfFile << "in the cache";
+    QFile::remove( base+".tmp" );
+    return "";
+  }
+  QFile bboxFile( base+".bbox" );
+  if ( ! bboxFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) { 
+    QFile::remove( base+".pdf" );
+    return "";
+  }
+  QTextStream out( &bboxFile );
+  foreach( QRectF bBox, bBoxes ) 
+    out << bBox.x() << " " << bBox.y() << " " << bBox.width() << " " << bBox.height() << "\n";
+  out.flush();
+  bboxFile.close();
+  if ( totalSize >= 0 ) totalSize += QFileInfo( base+".pdf" ).size();
+  evict();
+  return base+".pdf";
+}
+
+bool teXCache::contains( const QString &path ) { 
+  return QFileInfo( path ).absolutePath() == QFileInfo( dir() ).absoluteFilePath();
+}
+
+void teXCache::pin( const QString &path ) { 
+  pins[QFileInfo( path ).absoluteFilePath()]++;
+}
+
+void teXCache::unpin( const QString &path ) { 
+  QString abs = QFileInfo( path ).absoluteFilePath();
+  if ( --pins[abs] <= 0 ) pins.remove( abs );
+}
+
+void teXCache::evict() { 
+  qint64 limit = 64;
+  if ( config().haveKey( "tex_cache_size" ) && config()["tex_cache_size"].toInt() > 0 ) limit = config()["tex_cache_size"].toInt();
+  limit *= 1024*1024;
+  if ( totalSize >= 0 && totalSize <= limit ) return;
+  // the directory is listed on the first store and then only when the limit is exceeded
+  // (the other instances of the program can store into it, too)
+  QDir cache( dir() );
+  QFileInfoList entries = cache.entryInfoList( QStringList( "*.pdf" ), QDir::Files, QDir::Time ); // newest first
+  totalSize = 0;
+  foreach( QFileInfo entry, entries ) totalSize += entry.size();
+  if ( totalSize <= limit ) return;
+  limit -= limit/10; // leave some room, so that the next stores do not list the directory again
+  for( int i = entries.size()-1; i > 0 && totalSize > limit; --i ) { 
+    if ( pins.contains( entries[i].absoluteFilePath() ) ) continue; // in use
+    totalSize -= entries[i].size();
+    cache.remove( entries[i].fileName() );
+    cache.remove( entries[i].completeBaseName()+".bbox" );
+  }
+}
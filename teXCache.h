@@ -0,0 +1,92 @@
+#ifndef _teXCache_H
+#define _teXCache_H
+
+/**  This file is part of comment
+*
+*  File: teXCache.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QString>
+#include <QtCore/QRectF>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QFuture>
+
+/* teXCache --- a persistent, content addressed cache of compiled
+ *              snippets. An entry is keyed by the md5 of the complete
+ *              LaTeX source (which includes the preamble and the size
+ *              hint) and the version string of the TeX engine, and
+ *              consists of the compiled pdf and the bounding boxes of
+ *              its pages (as computed by compileJob, one per line),
+ *              stored as <key>.pdf and <key>.bbox in
+ *              config().cacheDir("tex").
+ *
+ *              The cache is limited in size (tex_cache_size key, in MB,
+ *              default 64), when it grows over the limit the least
+ *              recently used entries (by modification time, which
+ *              lookup updates) are removed, down to 90% of the limit.
+ *              The size is tracked in memory, so the directory is
+ *              listed only when the limit is exceeded. The cached pdfs
+ *              are owned by the cache, so the users must not delete
+ *              them, a pdf which is in use should be pinned.
+ */
+class teXCache { 
+	private:
+		static QHash<QString, QFuture<QString> > engineVersions;
+		static QString queryVersion( QString latexPath );
+
+		static qint64 totalSize; // the size of the cached pdfs, -1 until the directory is listed
+		static QHash<QString, int> pins;
+
+		static QString dir();
+		static void touch( const QString &path );
+		static void evict();
+
+	public:
+		/* Starts finding out the version of @latexPath in a worker thread
+		 * (once per engine), called when the paths are set. The returned
+		 * future tells whether engineVersion (and key) would wait. */
+		static QFuture<QString> resolveEngine( const QString &latexPath );
+		/* Returns the first line of `@latexPath --version`, waits only if
+		 * resolveEngine has not finished yet */
+		static QString engineVersion( const QString &latexPath );
+
+		static QString key( const QString &latexSource, const QString &latexPath );
+
+		/* If the entry @key exists, sets @pdfPath and @bBoxes and returns true */
+		static bool lookup( const QString &key, QString &pdfPath, QList<QRectF> &bBoxes );
+
+		/* Moves @pdfFile into the cache under @key, returns the path to the cached
+		 * pdf (or an empty string if the pdf could not be stored) */
+		static QString store( const QString &key, const QString &pdfFile, const QList<QRectF> &bBoxes );
+
+		/* Returns true if @path points into the cache */
+		static bool contains( const QString &path );
+
+		/* The cached pdf @path is not evicted while it is pinned (the pins
+		 * are counted, each pin must be paired with an unpin) */
+		static void pin( const QString &path );
+		static void unpin( const QString &path );
+};
+
+#endif /* _teXCache_H */
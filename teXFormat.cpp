@@ -0,0 +1,155 @@
+/**  This file is part of project comment
+ *
+ *  File: teXFormat.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "teXFormat.h"
+#include "teXCache.h"
+#include "config.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTime>
+#include <QtCore/QRegExp>
+#include <QtCore/QDebug>
+
+#include <sys/types.h>
+#include <utime.h>
+
+static const int maxFormats = 8;
+
+teXFormat::teXFormat() { 
+  enabled = ! ( config().haveKey( "tex_format" ) && config()["tex_format"] == "no" );
+}
+
+teXFormat *teXFormat::instance() { 
+  static teXFormat *formats = new teXFormat;
+  return formats;
+}
+
+QString teXFormat::dir() { 
+  return config().cacheDir( "texfmt" );
+}
+
+QString teXFormat::preamble( const QString &latexSource ) { 
+  int pos = latexSource.indexOf( "\\begin{document}" );
+  if ( pos < 0 ) return "";
+  return latexSource.left( pos );
+}
+
+QString teXFormat::key( const QString &latexSource, const QString &latexPath ) { 
+  QCryptographicHash md5( QCryptographicHash::Md5 );
+  md5.addData( teXCache::engineVersion( latexPath ).toUtf8() );
+  md5.addData( "\n", 1 );
+  md5.addData( preamble( latexSource ).toUtf8() );
+  return QString( md5.result().toHex() );
+}
+
+QString teXFormat::formatFor( const QString &latexSource, const QString &latexPath ) { 
+  if ( ! enabled || preamble( latexSource ).isEmpty() ) return "";
+  QString name = key( latexSource, latexPath );
+  if ( failed.contains( name ) || pending.contains( name ) ) return "";
+  QString fmt = dir()+"/"+name+".fmt";
+  if ( QFile::exists( fmt ) ) { 
+    utime( QFile::encodeName( fmt ).constData(), NULL ); // keep recently used formats from eviction
+    return name;
+  }
+
+  QFile src( dir()+"/"+name+".tex" );
+  if ( ! src.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) { 
+    failed.insert( name );
+    return "";
+  }
+  src.write( ( preamble( latexSource )+"\\begin{document}\n\\end{document}\n" ).toUtf8() );
+  src.close();
+
+  QProcess *proc = new QProcess( this );
+  proc->setWorkingDirectory( dir() );
+  connect( proc, SIGNAL( finished(int,QProcess::ExitStatus) ), this, SLOT( buildFinished(int,QProcess::ExitStatus) ) );
+  building.insert( proc, name );
+  pending.insert( name );
+  proc->start( latexPath, QStringList() << "-ini" << "-interaction=nonstopmode" << "-jobname="+name
+		       << "&"+QFileInfo( latexPath ).baseName() << "mylatexformat.ltx" << name+".tex" );
+  return "";
+}
+
+QString teXFormat::waitForFormat( const QString &latexSource, const QString &latexPath, int msecs ) { 
+  QString name = formatFor( latexSource, latexPath );
+  if ( name != "" || ! enabled ) return name;
+  name = key( latexSource, latexPath );
+  QTime timer;
+  timer.start();
+  while( pending.contains( name ) && timer.elapsed() < msecs ) 
+    QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents, 100 );
+  return formatFor( latexSource, latexPath );
+}
+
+void teXFormat::buildFinished( int eCode, QProcess::ExitStatus eStat ) { 
+  QProcess *proc = qobject_cast<QProcess *>( sender() );
+  if ( ! proc || ! building.contains( proc ) ) return;
+  QString name = building.take( proc );
+  pending.remove( name );
+  QDir fmtDir( dir() );
+  bool ok = ( eStat == QProcess::NormalExit && eCode == 0 && fmtDir.exists( name+".fmt" ) );
+  fmtDir.remove( name+".tex" );
+  fmtDir.remove( name+".log" );
+  if ( ok ) { 
+    evict();
+    emit formatReady( name );
+  } else { 
+    qWarning() << "teXFormat: Could not build the format for the preamble (is mylatexformat installed?), compiling without it";
+    fmtDir.remove( name+".fmt" );
+    failed.insert( name );
+  }
+  proc->deleteLater();
+}
+
+void teXFormat::invalidate( const QString &name ) { 
+  failed.insert( name );
+  QFile::remove( dir()+"/"+name+".fmt" );
+}
+
+void teXFormat::evict() { 
+  QDir fmtDir( dir() );
+  QFileInfoList formats = fmtDir.entryInfoList( QStringList( "*.fmt" ), QDir::Files, QDir::Time ); // newest first
+  while( formats.size() > maxFormats ) fmtDir.remove( formats.takeLast().fileName() );
+}
+
+QStringList teXFormat::environment() { 
+  QStringList env = QProcess::systemEnvironment();
+  int i = env.indexOf( QRegExp( "^TEXFORMATS=.*" ) );
+  if ( i > -1 ) env[i] = "TEXFORMATS="+dir()+":"+env[i].mid( 11 );
+  else env << "TEXFORMATS="+dir()+":"; // the trailing colon keeps the default search path
+  return env;
+}
+
+bool teXFormat::formatError( const QString &output ) { 
+  return output.contains( "format file" ) || output.contains( "Fatal format" );
+}
+
+#include "teXFormat.moc"
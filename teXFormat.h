@@ -0,0 +1,97 @@
+#ifndef _teXFormat_H
+#define _teXFormat_H
+
+/**  This file is part of comment
+*
+*  File: teXFormat.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QProcess>
+
+/* teXFormat --- builds (with mylatexformat) and keeps precompiled
+ *               formats for the preambles of the snippets, so that
+ *               compiling a snippet does not have to load the
+ *               document class and the packages again. A format is
+ *               keyed by the md5 of the preamble (everything before
+ *               \begin{document}) and the version of the TeX engine
+ *               and stored as <key>.fmt in config().cacheDir("texfmt").
+ *
+ *               A format is built in the background the first time
+ *               its preamble is asked for, until it is ready the
+ *               snippets are compiled the usual way. A format which
+ *               fails to build (e.g. mylatexformat is not installed)
+ *               or to load is not tried again in the same session.
+ *               Setting the tex_format configuration key to "no"
+ *               disables the formats.
+ */
+class teXFormat : public QObject { 
+  Q_OBJECT
+	private:
+		QHash<QProcess *, QString> building;
+		QSet<QString> pending, failed;
+		bool enabled;
+
+		teXFormat();
+		static QString dir();
+		void evict();
+
+	private slots:
+		void buildFinished( int eCode, QProcess::ExitStatus eStat );
+
+	public:
+		static teXFormat *instance();
+
+		bool isEnabled() const { return enabled; };
+		void setEnabled( bool e ) { enabled = e; };
+
+		/* Returns the part of @latexSource preceding \begin{document} */
+		static QString preamble( const QString &latexSource );
+		static QString key( const QString &latexSource, const QString &latexPath );
+
+		/* Returns the name of the format for the preamble of @latexSource,
+		 * if it is ready. Otherwise starts building it (unless it failed before)
+		 * and returns an empty string. */
+		QString formatFor( const QString &latexSource, const QString &latexPath );
+
+		/* Like formatFor, but waits (at most @msecs) for the format to be built */
+		QString waitForFormat( const QString &latexSource, const QString &latexPath, int msecs = 60000 );
+
+		/* Marks the format @name as unusable */
+		void invalidate( const QString &name );
+
+		/* The environment for the latex process, which lets it find the formats */
+		static QStringList environment();
+
+		/* Returns true if @output (of a latex run) complains about the format */
+		static bool formatError( const QString &output );
+
+	signals:
+		void formatReady( QString name );
+};
+
+#endif /* _teXFormat_H */
@@ -0,0 +1,71 @@
+/**  This file is part of project comment
+ *
+ *  File: teXScratch.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "teXScratch.h"
+#include "teXWorker.h"
+#include "config.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDebug>
+
+#include <stdlib.h>
+
+QString teXScratch::path;
+
+// the files latex (and the worker's body) leave next to the source
+static const char *jobSuffixes[] = { ".aux", ".log", ".out", ".body", NULL };
+
+QString teXScratch::dir() { 
+  if ( path != "" ) return path;
+  QString parent = QDir::tempPath();
+  if ( config().haveKey( "tex_scratch_dir" ) && config()["tex_scratch_dir"] != "" ) parent = config()["tex_scratch_dir"];
+  else if ( QFileInfo( "/dev/shm" ).isDir() && QFileInfo( "/dev/shm" ).isWritable() ) parent = "/dev/shm";
+  QByteArray tmpl = QFile::encodeName( parent+"/commentTeXXXXXXX" );
+  if ( mkdtemp( tmpl.data() ) ) { 
+    path = QFile::decodeName( tmpl );
+    qAddPostRoutine( cleanup );
+  } else { 
+    qWarning() << "teXScratch: Cannot create a directory in" << parent << ", using" << QDir::tempPath();
+    path = QDir::tempPath();
+  }
+  return path;
+}
+
+void teXScratch::removeJobFiles( const QString &base ) { 
+  for( int i = 0; jobSuffixes[i]; ++i ) QFile::remove( base+jobSuffixes[i] );
+}
+
+void teXScratch::cleanup() { 
+  teXWorkerPool::instance()->shutdown(); // the idle workers write into the directory
+  QDir scratch( path );
+  foreach( QString fl, scratch.entryList( QDir::Files | QDir::Hidden ) ) scratch.remove( fl );
+  if ( ! QDir().rmdir( path ) ) qWarning() << "teXScratch: Cannot remove" << path;
+  path = "";
+}
@@ -0,0 +1,56 @@
+#ifndef _teXScratch_H
+#define _teXScratch_H
+
+/**  This file is part of comment
+*
+*  File: teXScratch.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QString>
+
+/* teXScratch --- the private directory of the running session which
+ *                the compileJobs and teXWorkers write their sources
+ *                and the latex output into. It is created on the first
+ *                use in /dev/shm (i.e. in memory) if it is available,
+ *                otherwise in QDir::tempPath(), the tex_scratch_dir key
+ *                gives another parent directory.
+ *
+ *                A job removes the files it knows about by their names
+ *                (see removeJobFiles), so no directory is ever listed
+ *                after a job, anything else is left until the directory
+ *                is removed as a whole when the application exits.
+ */
+class teXScratch { 
+	private:
+		static QString path;
+		static void cleanup();
+
+	public:
+		static QString dir();
+
+		/* Removes the files latex writes next to the result for the source
+		 * @base (i.e. @base.aux, @base.log, ...), keeps @base.pdf */
+		static void removeJobFiles( const QString &base );
+};
+
+#endif /* _teXScratch_H */
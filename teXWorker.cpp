@@ -0,0 +1,161 @@
+/**  This file is part of project comment
+ *
+ *  File: teXWorker.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "teXWorker.h"
+#include "teXFormat.h"
+#include "teXScratch.h"
+#include "config.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QStringList>
+#include <QtCore/QDebug>
+
+static const int maxIdle = 2;
+static const int maxFailures = 3;
+
+teXWorker::teXWorker( const QString &latexSource, const QString &latexPath, const QString &key ):
+	proc( NULL ), workerKey( key )
+{
+  proc = new QProcess( this );
+  proc->setWorkingDirectory( teXScratch::dir() );
+  QTemporaryFile driver( teXScratch::dir()+"/workerXXXXXX" );
+  driver.setAutoRemove( false );
+  if ( ! driver.open() ) { 
+    qWarning() << "teXWorker: Cannot open temporary file.";
+    return;
+  }
+  driverFile = driver.fileName();
+  // the body is input from the file whose name comes on the terminal (\endlinechar=-1 keeps the name free of the trailing space)
+  driver.write( ( teXFormat::preamble( latexSource ) + "\\begin{document}\n"
+		  "{\\endlinechar=-1 \\global\\read16 to \\commentsnippet}\n"
+		  "\\input{\\commentsnippet}\n"
+		  "\\end{document}\n" ).toUtf8() );
+  driver.close();
+
+  // a \read from the terminal is not allowed in the nonstop modes
+  QStringList args( "-interaction=scrollmode" );
+  QString fmt = teXFormat::instance()->formatFor( latexSource, latexPath );
+  if ( fmt != "" ) { 
+    args << "-fmt="+fmt;
+    proc->setEnvironment( teXFormat::environment() );
+  }
+  args << driverFile;
+  proc->start( latexPath, args );
+}
+
+teXWorker::~teXWorker() { 
+  if ( proc->state() != QProcess::NotRunning ) { // the process object outlives the worker until it is gone, so that nobody waits for it
+    disconnect( proc, 0, 0, 0 );
+    proc->setParent( NULL );
+    connect( proc, SIGNAL( finished(int,QProcess::ExitStatus) ), proc, SLOT( deleteLater() ) );
+    proc->kill();
+  }
+  if ( driverFile == "" ) return;
+  QFile::remove( driverFile );
+  teXScratch::removeJobFiles( driverFile );
+}
+
+QString teXWorker::body( const QString &latexSource ) { 
+  int start = latexSource.indexOf( "\\begin{document}" ), end = latexSource.lastIndexOf( "\\end{document}" );
+  if ( start < 0 || end < start ) return "";
+  start += QString( "\\begin{document}" ).size();
+  return latexSource.mid( start, end-start );
+}
+
+void teXWorker::compile( const QString &bodyFile ) { 
+  proc->write( QFile::encodeName( bodyFile )+"\n" );
+  proc->closeWriteChannel(); // if the snippet asks for more input (e.g. a missing file), it gets EOF instead of waiting forever
+}
+
+
+
+teXWorkerPool::teXWorkerPool() { 
+  enabled = ! ( config().haveKey( "tex_worker" ) && config()["tex_worker"] == "no" );
+  if ( QCoreApplication::instance() ) connect( QCoreApplication::instance(), SIGNAL( aboutToQuit() ), this, SLOT( shutdown() ) );
+}
+
+teXWorkerPool *teXWorkerPool::instance() { 
+  static teXWorkerPool *pool = new teXWorkerPool;
+  return pool;
+}
+
+teXWorker *teXWorkerPool::take( const QString &latexSource, const QString &latexPath ) { 
+  if ( ! enabled || teXWorker::body( latexSource ) == "" ) return NULL;
+  QString key = teXFormat::key( latexSource, latexPath );
+  if ( failures.value( key ) >= maxFailures ) return NULL;
+  teXWorker *worker = idle.take( key );
+  recent.removeOne( key );
+  if ( worker ) { 
+    disconnect( worker->process(), 0, this, 0 );
+    if ( ! worker->isAlive() ) { 
+      delete worker;
+      worker = NULL;
+    }
+  }
+  spawn( key, latexSource, latexPath ); // the spare for the next snippet
+  return worker;
+}
+
+void teXWorkerPool::spawn( const QString &key, const QString &latexSource, const QString &latexPath ) { 
+  if ( idle.size() >= maxIdle ) delete idle.take( recent.takeFirst() );
+  teXWorker *worker = new teXWorker( latexSource, latexPath, key );
+  connect( worker->process(), SIGNAL( finished(int,QProcess::ExitStatus) ), this, SLOT( idleWorkerDied() ) );
+  idle.insert( key, worker );
+  recent.append( key );
+}
+
+void teXWorkerPool::idleWorkerDied() { 
+  QHash<QString, teXWorker *>::iterator it;
+  for( it = idle.begin(); it != idle.end(); ++it ) { 
+    if ( it.value()->process() == sender() ) { 
+      qWarning() << "teXWorkerPool: An idle TeX worker died";
+      reportFailure( it.key() );
+      recent.removeOne( it.key() );
+      it.value()->deleteLater();
+      idle.erase( it );
+      return;
+    }
+  }
+}
+
+void teXWorkerPool::shutdown() { 
+  qDeleteAll( idle );
+  idle.clear();
+  recent.clear();
+}
+
+void teXWorkerPool::reportFailure( const QString &key ) { 
+  failures[key]++;
+}
+
+void teXWorkerPool::reportSuccess( const QString &key ) { 
+  failures.remove( key );
+}
+
+#include "teXWorker.moc"
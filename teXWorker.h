@@ -0,0 +1,119 @@
+#ifndef _teXWorker_H
+#define _teXWorker_H
+
+/**  This file is part of comment
+*
+*  File: teXWorker.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QProcess>
+
+/* teXWorker --- a pdflatex process started ahead of time: it loads
+ *               the preamble of a snippet (from the precompiled format,
+ *               if there is one, see teXFormat) and then waits (in a
+ *               \read from the terminal) for the name of a file with
+ *               the body of the snippet, which it inputs and ends the
+ *               document.
+ *
+ *               Since pdfTeX writes the page tree and the xref table
+ *               of a pdf only when the document ends, one process can
+ *               not ship out several independent pdfs, so a worker
+ *               compiles exactly one snippet. The gain is that the
+ *               process startup and the preamble are paid in advance,
+ *               while nobody waits for them.
+ */
+class teXWorker : public QObject { 
+  Q_OBJECT
+	private:
+		QProcess *proc;
+		QString driverFile;
+		QString workerKey;
+
+	public:
+		teXWorker( const QString &latexSource, const QString &latexPath, const QString &key );
+		/* Kills the process (if it still runs, without waiting for it) and
+		 * removes its files, except the pdf */
+		~teXWorker();
+
+		/* Returns the part of @latexSource between \begin{document} and \end{document} */
+		static QString body( const QString &latexSource );
+
+		QProcess *process() { return proc; };
+		QString key() const { return workerKey; };
+		QString pdfFile() const { return driverFile+".pdf"; };
+		bool isAlive() const { return proc->state() != QProcess::NotRunning; };
+
+		/* Sends the name of the file with the body, the finished signal of
+		 * process() tells when the pdf is written */
+		void compile( const QString &bodyFile );
+};
+
+/* teXWorkerPool --- keeps a spare teXWorker for each of the recently
+ *                   used preambles (at most maxIdle of them). Taking
+ *                   the spare worker starts a new one for the next
+ *                   snippet, so the first snippet with a new preamble
+ *                   is compiled by compileJob the usual way. A
+ *                   preamble whose workers repeatedly fail is not given
+ *                   workers any more. Setting the tex_worker
+ *                   configuration key to "no" disables the workers.
+ *                   The idle workers are shut down when the application
+ *                   quits.
+ */
+class teXWorkerPool : public QObject { 
+  Q_OBJECT
+	private:
+		QHash<QString, teXWorker *> idle;
+		QStringList recent; // the keys of the idle workers, the least recently used first
+		QHash<QString, int> failures;
+		bool enabled;
+
+		teXWorkerPool();
+		void spawn( const QString &key, const QString &latexSource, const QString &latexPath );
+
+	private slots:
+		void idleWorkerDied();
+
+	public slots:
+		/* Kills the idle workers */
+		void shutdown();
+
+	public:
+		static teXWorkerPool *instance();
+
+		bool isEnabled() const { return enabled; };
+		void setEnabled( bool e ) { enabled = e; };
+
+		/* Returns the spare worker for the preamble of @latexSource (or NULL
+		 * if there is none); the caller owns the returned worker */
+		teXWorker *take( const QString &latexSource, const QString &latexPath );
+
+		void reportFailure( const QString &key );
+		void reportSuccess( const QString &key );
+};
+
+#endif /* _teXWorker_H */
@@ -28,14 +28,22 @@
 
 #include "teXjob.h"
 #include "config.h"
+#include "compileScheduler.h"
+#include "teXCache.h"
+#include "teXFormat.h"
+#include "teXWorker.h"
+#include "teXScratch.h"
 
 #include <QtCore/QDebug>
 #include <QtCore/QProcess>
 #include <QtCore/QDir>
 #include <QtCore/QFileInfo>
-#include <QtCore/QRegExp>
+#include <QtCore/QtConcurrentRun>
+
+#include <QtGui/QImage>
 
 #include <poppler-qt4.h>
+#include <podofo/podofo.h>
 
 
 QString compileJob::latexPath("/usr/bin/pdflatex");
@@ -43,18 +51,25 @@ QString compileJob::gsPath("/usr/bin/gs");
 bool compileJob::paths_ok = true;
 
 compileJob::compileJob():
-	proc(NULL), jobStarted(false), tmpSRC( NULL )
+	proc(NULL), jobStarted(false), launched(false), cacheHitPending(false), cacheResults(true), failurePending(false), tmpSRC( NULL ), worker( NULL ),
+	queueMs( -1 ), latexMs( -1 ), bboxMs( -1 )
 {
   proc = new QProcess( this );
-  proc->setWorkingDirectory( QDir::tempPath() );
+  proc->setWorkingDirectory( teXScratch::dir() ); // latex writes its output into the working directory
+  bboxWatcher = new QFutureWatcher<QList<QRectF> >( this );
   paths_ok = config().haveTeX();
   setPaths( config()["tex"], config()["gs"] );
 }
 
 compileJob::~compileJob() { 
+  disconnect( bboxWatcher, 0, 0, 0 ); // a running computation only needs the file name, so it can finish on its own
+  delete worker;
   if ( jobStarted || (proc->state() != QProcess::NotRunning)) {
+    disconnect( proc, 0, 0, 0 );
     proc->kill();
   }
+  if ( launched ) compileScheduler::instance()->jobDone( this );
+  else if ( jobStarted ) compileScheduler::instance()->cancel( this );
   delete proc;
 }
 
@@ -63,6 +78,7 @@ void compileJob::setPaths( QString latex, QString gs ) {
     latexPath = latex;
     gsPath = gs;
     paths_ok = true;
+    teXCache::resolveEngine( latexPath ); // the cache keys need the version
   }
 }
 
@@ -70,6 +86,10 @@ bool compileJob::pathsOK() {
   return paths_ok;
 }
 
+QFuture<QString> compileJob::engineVersion() { 
+  return teXCache::resolveEngine( latexPath );
+}
+
 bool compileJob::checkPaths( QString latex, QString gs ) { 
   return true;
 }
@@ -79,27 +99,74 @@ QString compileJob::texName2Pdf( QString fname ) {
 }
 
 void compileJob::removeTempFiles() { 
-  QFileInfo info( *tmpSRC );
-  QString baseName=info.baseName();
-  QDir dir = info.absoluteDir();
-  dir.setNameFilters( QStringList(baseName +".*") );
-  foreach( QString fl, dir.entryList() ) {
-    if ( ! fl.endsWith( ".pdf" ) ) dir.remove( fl );
-  }
+  if ( ! tmpSRC ) return; // already removed when latex finished
+  teXScratch::removeJobFiles( tmpSRC->fileName() );
   delete tmpSRC;
   tmpSRC=NULL;
 }
 
-QRectF compileJob::parseGSOutput() { 
-  Q_ASSERT( proc );
-  QRegExp exp("HiResBoundingBox: *([0-9.]*) *([0-9.]*) *([0-9.]*) *([0-9.]*) *");
-  QString output( proc->readAllStandardError() );
-  if ( exp.indexIn( output ) > -1 ) {
-    qreal x = exp.cap(1).toFloat(), y = exp.cap(2).toFloat();
-    qreal w = (exp.cap(3).toFloat()-x), h = (exp.cap(4).toFloat()-y);
-    return QRectF( x, y, w, h );
-  } else 
-    return QRectF( 0,0,0,0 );
+/* Returns the bounding rectangle of the non-white pixels of @img (null if there are none) */
+static QRect inkRect( const QImage &img ) { 
+  int left = img.width(), right = -1, top = -1, bottom = -1;
+  for( int y = 0; y < img.height(); ++y ) { 
+    const QRgb *line = (const QRgb *) img.constScanLine( y );
+    int x = 0;
+    while( x < img.width() && ( line[x] & 0xffffff ) == 0xffffff ) x++;
+    if ( x == img.width() ) continue;
+    if ( top < 0 ) top = y;
+    bottom = y;
+    left = qMin( left, x );
+    x = img.width()-1;
+    while( ( line[x] & 0xffffff ) == 0xffffff ) x--;
+    right = qMax( right, x );
+  }
+  if ( top < 0 ) return QRect();
+  return QRect( QPoint( left, top ), QPoint( right, bottom ) );
+}
+
+/* Each page is first rendered at 72 dpi (one pixel per point) to find
+ * the ink roughly and then only the area around it is rendered again
+ * at fineScale times the resolution, which gives the bounding box with
+ * a precision of 1/fineScale pt (ghostscript's bbox device was used for
+ * this before, at the cost of another process per snippet) */
+QList<QRectF> compileJob::computeBBoxes( QString pdfFile ) { 
+  static const int fineScale = 8;
+  QList<QRectF> ret;
+  Poppler::Document *pdf = Poppler::Document::load( pdfFile );
+  if ( ! pdf ) return ret;
+  pdf->setRenderHint( Poppler::Document::Antialiasing, true );
+  pdf->setRenderHint( Poppler::Document::TextAntialiasing, true );
+  for( int i = 0; i < pdf->numPages(); ++i ) { 
+    Poppler::Page *pg = pdf->page( i );
+    qreal pgHeight = pg->pageSizeF().height();
+    QRect coarse = inkRect( pg->renderToImage( 72, 72 ).convertToFormat( QImage::Format_RGB32 ) );
+    if ( coarse.isNull() ) { 
+      ret.append( QRectF( 0,0,0,0 ) );
+      delete pg;
+      continue;
+    }
+    coarse.adjust( -1, -1, 1, 1 );
+    QImage img = pg->renderToImage( 72*fineScale, 72*fineScale, coarse.x()*fineScale, coarse.y()*fineScale,
+				    coarse.width()*fineScale, coarse.height()*fineScale ).convertToFormat( QImage::Format_RGB32 );
+    QRect fine = inkRect( img );
+    if ( fine.isNull() ) fine = QRect( 0, 0, img.width(), img.height() );
+    qreal left = coarse.x() + (qreal) fine.left()/fineScale, right = coarse.x() + (qreal) (fine.right()+1)/fineScale;
+    qreal top = coarse.y() + (qreal) fine.top()/fineScale, bottom = coarse.y() + (qreal) (fine.bottom()+1)/fineScale;
+    ret.append( QRectF( left, pgHeight-bottom, right-left, bottom-top ) );
+    delete pg;
+  }
+  delete pdf;
+  return ret;
+}
+
+bool compileJob::isCached( QString latexSource ) { 
+  QString pdfPath;
+  QList<QRectF> bBoxes;
+  return teXCache::lookup( teXCache::key( latexSource, latexPath ), pdfPath, bBoxes );
+}
+
+QString compileJob::storeResult( QString latexSource, QString pdfFile, QList<QRectF> bBoxes ) { 
+  return teXCache::store( teXCache::key( latexSource, latexPath ), pdfFile, bBoxes );
 }
 
 
@@ -109,45 +176,142 @@ QRectF compileJob::parseGSOutput() {
 
 void compileJob::start( QString latexSource ) { 
   if ( ! paths_ok ) {
-    qWarning() << " Could not find pdfTeX or GhostScript ";
+    qWarning() << " Could not find pdfTeX ";
     return;
   }
   if ( jobStarted ) { 
     qWarning() << "Cannot start while another job in progress. Please use the restart method";
     return;
   }
-  tmpSRC = new QTemporaryFile( QDir::tempPath()+"/testTeXRenderXXXXXX" );
+  source = latexSource;
+  jobStarted=true;
+  failurePending = false;
+  queueMs = latexMs = bboxMs = -1;
+  stageTimer.start();
+  if ( lookupCache() ) return;
+  compileScheduler::instance()->submit( this );
+}
+
+/* If the source was already compiled, skips the compilation and
+ * schedules the finished signal with the cached result */
+bool compileJob::lookupCache() { 
+  if ( ! cacheResults ) return false;
+  if ( ! teXCache::lookup( teXCache::key( source, latexPath ), cachedPdf, cachedBBoxes ) ) return false;
+  cacheHitPending = true;
+  QMetaObject::invokeMethod( this, "cacheHit", Qt::QueuedConnection );
+  return true;
+}
+
+void compileJob::cacheHit() { 
+  if ( ! cacheHitPending ) return; // killed or restarted in the meantime
+  cacheHitPending = false;
+  jobStarted = false;
+  emit finished( cachedPdf, cachedBBoxes, true );
+}
+
+void compileJob::launchFailed() { 
+  if ( ! failurePending ) return; // restarted or killed in the meantime
+  failurePending = false;
+  emit finished( QString(""), QList<QRectF>(), false );
+}
+
+void compileJob::launch() { 
+  if ( lookupCache() ) { // the source could have been replaced while in the queue
+    compileScheduler::instance()->jobDone( this );
+    return;
+  }
+  tmpSRC = new QTemporaryFile( teXScratch::dir()+"/snippetXXXXXX" );
   if ( ! tmpSRC->open() ) {
     qWarning() << "Cannot open temporary file.";
-    emit finished( QString(""), QRectF(0,0,0,0), false );
+    delete tmpSRC;
+    tmpSRC = NULL;
+    jobStarted = false;
+    failurePending = true;
+    compileScheduler::instance()->jobDone( this );
+    // launch is called from inside the scheduler, the receivers must not run there
+    QMetaObject::invokeMethod( this, "launchFailed", Qt::QueuedConnection );
+    return;
   }
-  tmpSRC->write(latexSource.toUtf8());//.toLocal8Bit() FIXME: can fail if unexpected characters
+  tmpSRC->write(source.toUtf8());//.toLocal8Bit() FIXME: can fail if unexpected characters
   tmpSRC->flush();
-  jobStarted=true;
+  launched=true;
+  queueMs = stageTimer.restart();
+  worker = teXWorkerPool::instance()->take( source, latexPath );
+  if ( worker && startWorker() ) return;
+  fmtName = teXFormat::instance()->formatFor( source, latexPath );
+  startLaTeX();
+}
+
+/* The worker gets only the body of the source, the complete source stays
+ * in tmpSRC in case the worker fails */
+bool compileJob::startWorker() { 
+  QFile bodyFile( tmpSRC->fileName()+".body" );
+  if ( ! bodyFile.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) { 
+    dropWorker();
+    return false;
+  }
+  bodyFile.write( teXWorker::body( source ).toUtf8() );
+  bodyFile.close();
+  connect( worker->process(), SIGNAL( finished(int,QProcess::ExitStatus) ), this, SLOT(texJobFinished(int,QProcess::ExitStatus)) ); 
+  worker->compile( bodyFile.fileName() );
+  return true;
+}
+
+void compileJob::dropWorker() { 
+  if ( ! worker ) return;
+  disconnect( worker->process(), 0, this, 0 );
+  worker->deleteLater(); // can be called from the finished signal of its process
+  worker = NULL;
+}
+
+void compileJob::startLaTeX() { 
+  QStringList args( "-interaction=nonstopmode" );
+  if ( fmtName != "" ) { 
+    args << "-fmt="+fmtName;
+    proc->setEnvironment( teXFormat::environment() );
+  } else proc->setEnvironment( QProcess::systemEnvironment() );
+  args << tmpSRC->fileName();
   disconnect( proc, 0, 0, 0 );
   connect( proc, SIGNAL( finished(int,QProcess::ExitStatus) ), this, SLOT(texJobFinished(int,QProcess::ExitStatus)) ); 
-  proc->start( latexPath , ( QStringList() << "-interaction=nonstopmode" << tmpSRC->fileName() ) );
+  proc->start( latexPath , args );
 }
 
 void compileJob::restart( QString latexSource ) { 
   disconnect( proc, 0, 0, 0 );
-  if ( jobStarted ||  (proc->state() != QProcess::NotRunning) ) { 
+  disconnect( bboxWatcher, 0, 0, 0 );
+  dropWorker();
+  if ( cacheHitPending ) { 
+    cacheHitPending = false;
+    jobStarted = false;
+  } else if ( jobStarted && ! launched ) { // still queued, just replace the source
+    source = latexSource;
+    return;
+  }
+  if ( launched ) { 
     proc->kill();
     removeTempFiles();
+    launched=false;
     jobStarted=false;
+    compileScheduler::instance()->jobDone( this );
   }
   start( latexSource );
 }
 
 void compileJob::kill() { 
    disconnect( proc, 0, 0, 0 );
-   if ( (proc->state() != QProcess::NotRunning) ) { 
-     proc->kill();
+   disconnect( bboxWatcher, 0, 0, 0 );
+   dropWorker();
+   cacheHitPending = false;
+   failurePending = false;
+   if ( launched ) { 
+     if ( proc->state() != QProcess::NotRunning ) proc->kill();
      removeTempFiles();
-   }
+     launched=false;
+     compileScheduler::instance()->jobDone( this );
+   } else if ( jobStarted ) compileScheduler::instance()->cancel( this );
    if ( jobStarted ) { 
      jobStarted=false;
-     emit finished( QString(""),QRectF(0,0,0,0), false );
+     emit finished( QString(""), QList<QRectF>(), false );
    }
 }
 
@@ -155,86 +319,158 @@ bool compileJob::running() {
   return jobStarted;
 }
 
+void compileJob::prioritize() { 
+  if ( jobStarted && ! launched ) compileScheduler::instance()->prioritize( this );
+}
+
 void compileJob::texJobFinished( int eCode, QProcess::ExitStatus eStat ) {
-  pdfFName = texName2Pdf(tmpSRC->fileName());
+  if ( worker ) { 
+    pdfFName = worker->pdfFile();
+    QString key = worker->key();
+    // an error in the snippet is not the worker's fault, only a crash or a run without a TeX error message is
+    bool teXError = eStat == QProcess::NormalExit && worker->process()->readAllStandardOutput().contains( "\n! " );
+    dropWorker();
+    if ( ! QFile::exists( pdfFName ) ) { 
+      qWarning() << "compileJob: The TeX worker failed, compiling without it";
+      if ( ! teXError ) teXWorkerPool::instance()->reportFailure( key );
+      fmtName = teXFormat::instance()->formatFor( source, latexPath );
+      startLaTeX();
+      return;
+    }
+    teXWorkerPool::instance()->reportSuccess( key );
+  } else pdfFName = texName2Pdf(tmpSRC->fileName());
+  if ( fmtName != "" && ! QFile::exists( pdfFName ) && teXFormat::formatError( proc->readAllStandardOutput() ) ) { 
+    qWarning() << "compileJob: Cannot use the precompiled format" << fmtName << ", compiling without it";
+    teXFormat::instance()->invalidate( fmtName );
+    fmtName = "";
+    startLaTeX();
+    return;
+  }
   disconnect( proc, 0, 0, 0 );
-  connect( proc, SIGNAL( finished(int,QProcess::ExitStatus) ), this, SLOT(gsJobFinished(int,QProcess::ExitStatus)) ); 
-  proc->start( gsPath, (QStringList() << "-sDEVICE=bbox" <<"-dBATCH"<<"-dNOPAUSE"<<"-f"<<pdfFName) );
+  removeTempFiles();
+  latexMs = stageTimer.restart();
+  connect( bboxWatcher, SIGNAL( finished() ), this, SLOT( bboxFinished() ) );
+  bboxWatcher->setFuture( QtConcurrent::run( computeBBoxes, pdfFName ) );
 }
 
-void compileJob::gsJobFinished( int eCode, QProcess::ExitStatus eStat ) {
-  removeTempFiles();
-  disconnect( proc, 0, 0, 0 );
+void compileJob::bboxFinished() {
+  disconnect( bboxWatcher, 0, 0, 0 );
   jobStarted=false;
-  QRectF bBox = parseGSOutput();
-  emit finished( pdfFName, bBox, true );
+  launched=false;
+  QList<QRectF> bBoxes = bboxWatcher->result();
+  bboxMs = stageTimer.elapsed();
+  if ( bBoxes.isEmpty() ) bBoxes.append( QRectF( 0,0,0,0 ) );
+  if ( cacheResults && QFile::exists( pdfFName ) ) { 
+    QString cached = teXCache::store( teXCache::key( source, latexPath ), pdfFName, bBoxes );
+    if ( cached != "" ) pdfFName = cached;
+  }
+  compileScheduler::instance()->jobDone( this );
+  emit finished( pdfFName, bBoxes, true );
 }
 
 
 renderItem::~renderItem() { 
-  if ( pdf ) {
-    delete pdf; // FIXME: also delete the underlying file
+  leaveBatch();
+  if ( pdfFileName != "" && teXCache::contains( pdfFileName ) ) teXCache::unpin( pdfFileName );
+  else if ( pdfFileName != "" && ownsPdf ) { // the cached pdfs belong to the cache
     QFileInfo info( pdfFileName );
     QDir dir = info.absoluteDir();
     dir.remove( info.fileName() );
     qDebug() << "Deleting PDF: "<< dir << "/" << info.fileName();
   }
-  delete localLoop;
 }
 
 renderItem::renderItem( QString source, QString preamb ):
-	src(source), pre(preamb), ready(false), bBox(0,0,0,0), job_id(-1), pdf(NULL),
-	waiting_for_job(false), pdfFileName("")
+	src(source), pre(preamb), ready(false), failed(false), bBox(0,0,0,0), job_id(-1),
+	pdfFileName(""), pdfPage(0), ownsPdf(true), batch(NULL), batchSizeHint(50)
 { 
-  connect( &job, SIGNAL( finished(QString,QRectF,bool) ), this, SLOT( pdfReady(QString,QRectF,bool) ) );
-  localLoop = new QEventLoop( this );
+  connect( &job, SIGNAL( finished(QString,QList<QRectF>,bool) ), this, SLOT( pdfReady(QString,QList<QRectF>,bool) ) );
 }
 
-void renderItem::pdfReady( QString pdfFName, QRectF BBox, bool status ) { 
+void renderItem::pdfReady( QString pdfFName, QList<QRectF> bBoxes, bool status ) { 
+  setResult( pdfFName, 0, bBoxes.value( 0 ), status, false );
+  failed = ! status;
+}
+
+void renderItem::batchReady( QString pdfFName, int page, QRectF BBox, bool status ) { 
+  batch = NULL;
+  if ( ! status ) { // the item is compiled on its own, so that an error in another item of the batch does not hurt it
+    if ( job_id > -1 ) preRender( job_id, false, batchSizeHint );
+    return;
+  }
+  setResult( pdfFName, page, BBox, status, true );
+}
+
+void renderItem::setResult( QString pdfFName, int page, QRectF BBox, bool status, bool shared ) { 
+  if ( status && ! QFile::exists( pdfFName ) ) status = false;
   if ( ! status ) {
     ready = false;
     qWarning() << "renderItem::pdfReady: Error compiling latex. Job failed.";
   } else { 
+    if ( pdfFName != pdfFileName ) { // a cached pdf must not be evicted while the item uses it
+      if ( teXCache::contains( pdfFName ) ) teXCache::pin( pdfFName );
+      if ( pdfFileName != "" && teXCache::contains( pdfFileName ) ) teXCache::unpin( pdfFileName );
+    }
     pdfFileName = pdfFName;
-    if ( pdf ) delete pdf;
-    pdf = Poppler::Document::load( pdfFName );
-    pdf->setRenderHint( Poppler::Document::TextAntialiasing, true );
-    pdf->setRenderHint( Poppler::Document::Antialiasing, true );
+    pdfPage = page;
+    ownsPdf = ! shared; // a pdf shared by the items of a batch is not deleted by any of them
     bBox=BBox;
     ready = true;
   }
-  if ( waiting_for_job ) {
-    waiting_for_job = false;
-    localLoop->exit();
-  }
   if ( status && job_id > -1 ) {
     emit renderingReady( job_id );
     job_id = -1;
   }
 }
 
-void renderItem::wait_for_job() { 
-  if ( waiting_for_job ) {
-    qDebug() << "Warning, already waiting for job " << job_id;
-  } else { 
-    waiting_for_job = true;
-    localLoop->exec();
-  }
+QString renderItem::getLaTeXHeader( QString Pre ) {
+  return "\\documentclass[10pt,a4paper]{article}\n\\usepackage[utf8]{inputenc}\n\\usepackage{amssymb}\n\\usepackage{color}\n"+Pre+"\\begin{document}\n%\\pagecolor[rgb]{1,1,0.862}\n\\pagestyle{empty}\n";
+}
+
+QString renderItem::getLaTeXBody( QString Src, int sizeHint ) {
+  return "\\begin{minipage}{"+QString::number(sizeHint)+"mm}\n"+Src+"\n\\end{minipage}\n";
 }
 
 QString renderItem::getLaTeX( QString Src, QString Pre, int sizeHint ) {
-  return "\\documentclass[10pt,a4paper]{article}\n\\usepackage[utf8]{inputenc}\n\\usepackage{amssymb}\n\\usepackage{color}\n"+Pre+"\\begin{document}\n%\\pagecolor[rgb]{1,1,0.862}\n\\pagestyle{empty}\n\\begin{minipage}{"+QString::number(sizeHint)+"mm}\n"+Src+"\n\\end{minipage}\n\\end{document}\n";
+  return getLaTeXHeader( Pre )+getLaTeXBody( Src, sizeHint )+"\\end{document}\n";
+}
+
+bool renderItem::needsRendering() { 
+  return ! ready && ! failed && ! job.running() && ! batch;
 }
 
+bool renderItem::isCached( int sizeHint ) { 
+  return compileJob::isCached( getLaTeX( src, pre, sizeHint ) );
+}
+
+void renderItem::joinBatch( renderBatch *b, int jobID, int sizeHint ) { 
+  if ( job.running() ) job.kill();
+  leaveBatch();
+  job_id = jobID;
+  batch = b;
+  batchSizeHint = sizeHint;
+  batch->addItem( this, getLaTeXBody( src, sizeHint ) );
+}
+
+void renderItem::leaveBatch() { 
+  if ( ! batch ) return;
+  batch->removeItem( this );
+  batch = NULL;
+}
 
+void renderItem::prioritize() { 
+  if ( batch ) batch->prioritize();
+  else job.prioritize();
+}
 
 void renderItem::preRender( int jobID, bool format_inline, int sizeHint ) { 
-  if ( job.running() ) { 
-    if ( job_id == jobID ) return; // Probably already running, no need to run again.
-    job.kill();
-  };
+  leaveBatch();
+  QString latex = getLaTeX( src, pre, sizeHint );
+  if ( job.running() && job_id == jobID && latex == jobSource ) return; // already running, no need to run again.
   job_id = jobID;
-  job.start( getLaTeX( src, pre, sizeHint ) );
+  jobSource = latex;
+  if ( job.running() ) job.restart( latex ); // a queued job just gets the new source, a running one is killed
+  else job.start( latex );
 }
 
  
@@ -242,8 +478,8 @@ void renderItem::preRender( int jobID, bool format_inline, int sizeHint ) {
 void renderItem::updateItem( QString source, QString preambule, int jobID, bool format_inline, int sizeHint ) { 
   src = source;
   pre = preambule;
-  if ( pdf ) delete pdf; //FIXME: also delete the underlying file
-  pdf = NULL;
+  //FIXME: delete the underlying file
+  failed = false;
   bBox = QRectF(0,0,0,0);
   ready = false;
   preRender( jobID, format_inline, sizeHint );
@@ -253,27 +489,117 @@ int renderItem::size() {
   return (int) (bBox.width()*bBox.height());
 }
 
-QPixmap renderItem::render( qreal zoom, bool format_inline, int sizeHint ) { 
-  if ( job.running() ) wait_for_job();
-  if ( ! ready ) { 
-    job.start( getLaTeX( src, pre, sizeHint ) );
-    wait_for_job();
+QImage renderItem::rasterize( QString pdfFile, int page, QRectF bBox, qreal zoom ) { 
+  Poppler::Document *pdf = Poppler::Document::load( pdfFile );
+  if ( ! pdf ) return QImage();
+  pdf->setRenderHint( Poppler::Document::TextAntialiasing, true );
+  pdf->setRenderHint( Poppler::Document::Antialiasing, true );
+  Poppler::Page *pg = pdf->page( page );
+  if ( ! pg ) { 
+    delete pdf;
+    return QImage();
   }
-  if ( ready && pdf ) { 
-    Poppler::Page *pg = pdf->page(0);
-    qreal pgHeight = pg->pageSizeF().height();
-    qDebug() << "Rendering source ("<<72*zoom<<","<< 72*zoom<<","<< (int) bBox.x()<<","<<(int) (pg->pageSizeF().height()-bBox.y())<<","<<(int) bBox.width()<<","<<(int) bBox.height()<<")"; 
-    QImage image = pg->renderToImage( 72*zoom, 72*zoom );
- 
-    delete pg;
-    QPixmap px = QPixmap::fromImage( image );
-    qDebug() << "Rendered image: "<< image.width() << " x "<< image.height();
-    return px.copy( qRound(bBox.x()*zoom)-1, qRound((pgHeight-bBox.y()-bBox.height())*zoom)-1, qRound(bBox.width()*zoom)+2, qRound(bBox.height()*zoom)+2);
-  } else { 
-    return QPixmap();
+  qreal pgHeight = pg->pageSizeF().height();
+  // only the bounding box (not the whole page) is rendered
+  QImage image = pg->renderToImage( 72*zoom, 72*zoom, qRound(bBox.x()*zoom)-1, qRound((pgHeight-bBox.y()-bBox.height())*zoom)-1, 
+				    qRound(bBox.width()*zoom)+2, qRound(bBox.height()*zoom)+2 );
+  delete pg;
+  delete pdf;
+  return image;
+}
+
+
+
+
+renderBatch::renderBatch( QString preambule ):
+	pre( preambule )
+{
+  splitWatcher = new QFutureWatcher<QStringList>( this );
+  job.setCacheResults( false ); // nobody compiles the same batch again, the pages are cached one by one
+  connect( &job, SIGNAL( finished(QString,QList<QRectF>,bool) ), this, SLOT( pdfReady(QString,QList<QRectF>,bool) ) );
+}
+
+void renderBatch::addItem( renderItem *item, QString body ) { 
+  items.append( item );
+  bodies.append( body );
+}
+
+void renderBatch::removeItem( renderItem *item ) { 
+  int i = items.indexOf( item );
+  if ( i < 0 ) return;
+  items[i] = NULL; // the pages of the other items must not move
+  if ( items.count( NULL ) == items.size() && job.running() ) { // nobody is interested in the result
+    disconnect( &job, 0, this, 0 );
+    job.kill();
+    deleteLater();
   }
 }
 
+void renderBatch::start() { 
+  job.start( renderItem::getLaTeXHeader( pre )+bodies.join( "\\newpage\n" )+"\\end{document}\n" );
+}
 
+void renderBatch::pdfReady( QString pdfFName, QList<QRectF> bBoxes, bool status ) { 
+  if ( ! status || bBoxes.size() != bodies.size() ) { 
+    if ( status ) qWarning() << "renderBatch::pdfReady: Expected" << bodies.size() << "pages, got" << bBoxes.size() << ", compiling the items one by one";
+    finish( false );
+    return;
+  }
+  batchPdf = pdfFName;
+  pageBBoxes = bBoxes;
+  connect( splitWatcher, SIGNAL( finished() ), this, SLOT( pagesSplit() ) );
+  splitWatcher->setFuture( QtConcurrent::run( splitPages, pdfFName, bodies.size(), teXScratch::dir() ) );
+}
+
+QStringList renderBatch::splitPages( QString pdfFile, int pages, QString dir ) { 
+  QStringList ret;
+  try { 
+    PoDoFo::PdfMemDocument pdf( QFile::encodeName( pdfFile ).data() );
+    for( int i = 0; i < pages; ++i ) { 
+      QTemporaryFile tmp( dir+"/pageXXXXXX" );
+      if ( ! tmp.open() ) { 
+        ret.append( "" );
+        continue;
+      }
+      tmp.close();
+      PoDoFo::PdfMemDocument page;
+      page.InsertPages( pdf, i, 1 );
+      page.Write( QFile::encodeName( tmp.fileName() ).data() );
+      tmp.setAutoRemove( false );
+      ret.append( tmp.fileName() );
+    }
+  } catch ( PoDoFo::PdfError error ) { 
+    qWarning() << "renderBatch: Cannot split" << pdfFile << ":" << error.what();
+  }
+  return ret;
+}
+
+void renderBatch::pagesSplit() { 
+  disconnect( splitWatcher, 0, 0, 0 );
+  finish( true, splitWatcher->result() );
+}
+
+void renderBatch::finish( bool status, QStringList pagePdfs ) { 
+  bool batchPdfUsed = false;
+  for( int i = 0; i < items.size(); ++i ) { 
+    QString pdf = batchPdf;
+    int page = i;
+    if ( pagePdfs.value( i ) != "" ) { // the page is cached even if its item left the batch
+      QString cached = compileJob::storeResult( renderItem::getLaTeXHeader( pre )+bodies[i]+"\\end{document}\n", pagePdfs[i], QList<QRectF>() << pageBBoxes[i] );
+      if ( cached != "" ) { 
+        pdf = cached;
+        page = 0;
+      } else QFile::remove( pagePdfs[i] );
+    }
+    if ( items[i] ) { // the items can leave the batch in the meantime (e.g. when deleted)
+      if ( pdf == batchPdf ) batchPdfUsed = true;
+      renderItem *it = items[i];
+      items[i] = NULL;
+      it->batchReady( pdf, page, pageBBoxes.value( i ), status );
+    }
+  }
+  if ( batchPdf != "" && ! batchPdfUsed ) QFile::remove( batchPdf ); // not cached, otherwise it would be left in the scratch directory
+  deleteLater();
+}
 
 #include "teXjob.moc"
@@ -27,11 +27,17 @@
 */
 
 
-#include <QtCore/QEventLoop>
 #include <QtCore/QTemporaryFile>
 #include <QtCore/QProcess>
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QRectF>
+#include <QtCore/QTime>
 
-#include <QtGui/QPixmap>
+#include <QtGui/QImage>
+
+class teXWorker;
 
 
 class compileJob : public QObject { 
@@ -47,16 +53,49 @@ class compileJob : public QObject {
 		QTemporaryFile *tmpSRC;
 		QString pdfFName;
 		void removeTempFiles();
-		QRectF parseGSOutput();
+
+		/* Returns the tight bounding boxes (in pdf coordinates) of the ink
+		 * on the pages of @pdfFile. Runs in a worker thread. */
+		static QList<QRectF> computeBBoxes( QString pdfFile );
 
 
 		QProcess *proc;
-		bool jobStarted;
+		QFutureWatcher<QList<QRectF> > *bboxWatcher;
+		bool jobStarted; // true from start() until the job finishes (including the time spent in the queue)
+		bool launched; // true while latex or the bounding box computation runs (i.e. the job left the queue)
+		QString source;
+
+		// a cache hit is reported from the event loop (as if the job had run)
+		bool cacheHitPending;
+		bool cacheResults; // see setCacheResults
+		bool failurePending; // a failed launch is reported from the event loop, too
+		QString cachedPdf;
+		QList<QRectF> cachedBBoxes;
+		bool lookupCache();
+
+		// the precompiled format used for the current compilation (see teXFormat)
+		QString fmtName;
+		void startLaTeX();
+
+		// the durations of the stages of the last compilation (see queueTime)
+		QTime stageTimer;
+		int queueMs, latexMs, bboxMs;
+
+		// the prestarted pdflatex compiling the current source, if any (see teXWorker)
+		teXWorker *worker;
+		bool startWorker();
+		void dropWorker();
+
+		/* Called by the compileScheduler when the job's turn comes */
+		void launch();
+		friend class compileScheduler;
 
 	protected slots:
 
 		void texJobFinished(int,QProcess::ExitStatus);
-		void gsJobFinished(int,QProcess::ExitStatus);
+		void bboxFinished();
+		void cacheHit();
+		void launchFailed();
 
 
 
@@ -66,54 +105,147 @@ class compileJob : public QObject {
 
 		static void setPaths( QString latex, QString gs );
 		static bool pathsOK();
-
+		/* The version query of the latex in use (see teXCache::resolveEngine),
+		 * isCached and start wait for it */
+		static QFuture<QString> engineVersion();
+
+		/* Returns true if the result of compiling @latexSource is in the teXCache */
+		static bool isCached( QString latexSource );
+		/* Moves @pdfFile into the teXCache as the result of compiling @latexSource,
+		 * returns the path to the cached pdf (empty if it could not be stored) */
+		static QString storeResult( QString latexSource, QString pdfFile, QList<QRectF> bBoxes );
+
+		/* If @cache is false, the job neither looks up nor stores its
+		 * results in the teXCache (e.g. a renderBatch caches the pages
+		 * of its result separately). True by default. */
+		void setCacheResults( bool cache ) { cacheResults = cache; };
+
+		/* Queues the job with the compileScheduler */
 		void start( QString latexSource );
 		void restart( QString latexSource );
 		void kill();
 		bool running();
+		/* Moves the job to the front of the queue (if it is queued) */
+		void prioritize();
+
+		/* How long (in ms) the last compilation waited in the compileScheduler
+		 * queue, ran latex (including the retries) and computed the bounding boxes,
+		 * -1 for the stages which did not run (e.g. on a cache hit) */
+		int queueTime() const { return queueMs; };
+		int latexTime() const { return latexMs; };
+		int bboxTime() const { return bboxMs; };
 	signals:
-		void finished( QString resultPath, QRectF bBox, bool status );
+		/* @bBoxes contains the bounding box of each page of the result */
+		void finished( QString resultPath, QList<QRectF> bBoxes, bool status );
 };
 
-namespace Poppler { 
-  class Document;
-}
+class renderBatch;
 
 class renderItem : public QObject { 
   Q_OBJECT
 	private:
 		QString pre,src;
 		QString pdfFileName;
+		int pdfPage; // the page of pdfFileName holding the item (the pdf can be shared by a renderBatch)
+		bool ownsPdf;
 		QRectF bBox;
-		Poppler::Document *pdf;
 		int job_id;
 		compileJob job;
+		QString jobSource; // the source given to job
+		renderBatch *batch;
+		int batchSizeHint; // the size hint the item was given to the batch with
 		bool ready;
-		
-		
-		QEventLoop *localLoop;
-		bool waiting_for_job;
-		void wait_for_job();
+		bool failed; // the last compilation of the source failed, so it is not retried until the source changes
+
+		void setResult( QString pdfFName, int page, QRectF BBox, bool status, bool shared );
+		void leaveBatch();
 
 	private slots:
-		void pdfReady( QString pdfFName, QRectF bBox, bool status );
+		void pdfReady( QString pdfFName, QList<QRectF> bBoxes, bool status );
 
-	protected:
+	public:
 		static QString getLaTeX( QString source, QString preambule, int sizeHint );
+		/* The parts of getLaTeX: the header (up to and including \begin{document})
+		 * and the minipage holding the source */
+		static QString getLaTeXHeader( QString preambule );
+		static QString getLaTeXBody( QString source, int sizeHint );
 
-	public:
 		renderItem( QString source, QString preambule );
 		~renderItem();
 		void updateItem( QString source, QString preambule, int jobID = 0, bool format_inline = false, int sizeHint = 50 );
 		int size();
-		QPixmap render( qreal zoom, bool format_inline, int sizeHint );
 		void preRender( int jobID, bool format_inline, int sizeHint );
+		void prioritize();
 		QString getPDFFileName() const { return pdfFileName; };
+		int getPDFPage() const { return pdfPage; };
 		QRectF getBBox() const { return bBox; };
+		QString getPreambule() const { return pre; };
+
+		/* True if the item is compiled (i.e. it can be rasterized) */
+		bool isReady() const { return ready; };
+		/* True if the item is neither rendered nor being rendered (nor failed to render) */
+		bool needsRendering();
+
+		/* Renders the @bBox part of the page @page of @pdfFile (with a 1 pixel margin)
+		 * at @zoom. Does not touch any renderItem, so it can run in a worker thread. */
+		static QImage rasterize( QString pdfFile, int page, QRectF bBox, qreal zoom );
+		/* True if the source (typeset with @sizeHint) is in the teXCache */
+		bool isCached( int sizeHint );
+
+		/* Called by renderBatch */
+		void joinBatch( renderBatch *b, int jobID, int sizeHint );
+		void batchReady( QString pdfFName, int page, QRectF BBox, bool status );
 
 	signals:
 		void renderingReady( int jobID );
 };
 
+/* renderBatch --- compiles the sources of several renderItems (with
+ *                 the same preambule) as one document, one minipage
+ *                 per page, so that the latex process is started
+ *                 once for the whole batch. When the compilation is
+ *                 finished, the pages are split into separate pdfs
+ *                 which are stored in the teXCache under the sources
+ *                 of the single items (so that renderItem::isCached
+ *                 finds them), each item is handed its page and the
+ *                 batch deletes itself. If the pages do not match the
+ *                 items (e.g. a source contains \newpage), the items
+ *                 are compiled one by one.
+ */
+class renderBatch : public QObject { 
+  Q_OBJECT
+	private:
+		QString pre;
+		QList<renderItem *> items; // items[i] is typeset on page i, NULL if it left the batch
+		QStringList bodies;
+		compileJob job;
+
+		QString batchPdf;
+		QList<QRectF> pageBBoxes;
+		QFutureWatcher<QStringList> *splitWatcher;
+
+		/* Writes each of the first @pages pages of @pdfFile into a separate pdf
+		 * in @dir, returns their names (an empty name for a page which could
+		 * not be written). Runs in a worker thread. */
+		static QStringList splitPages( QString pdfFile, int pages, QString dir );
+		/* Hands the items their results (or makes them compile on their own
+		 * if @status is false) and deletes the batch */
+		void finish( bool status, QStringList pagePdfs = QStringList() );
+
+	private slots:
+		void pdfReady( QString pdfFName, QList<QRectF> bBoxes, bool status );
+		void pagesSplit();
+
+	public:
+		renderBatch( QString preambule );
+
+		void addItem( renderItem *item, QString body );
+		void removeItem( renderItem *item );
+		int size() const { return items.size(); };
+
+		void start();
+		void prioritize() { job.prioritize(); };
+};
+
 
 #endif /* _teXjob_H */
@@ -23,43 +23,284 @@
  *  Boston, MA 02110-1301, USA.
  */
 
+/* annot_rm --- removes the annotations from pdf files.
+ *
+ * The files are processed in parallel (-j), each one by a worker thread
+ * which loads it, removes the annotations and writes the result, so
+ * that at most jobs files are in memory at once; moreover a worker
+ * waits until the estimated memory of the files being processed fits
+ * into the budget (-m). Only the annotations of the given subtypes (-t)
+ * and/or authors (-a) can be removed (together with their popups). A
+ * file without annotations to remove is copied (or left alone when
+ * updating in place), and in the incremental mode (-u) the result is
+ * the original file with an update section appended, so the unchanged
+ * content is not rewritten. A line per file with its timings and a
+ * summary with the throughput are printed (tab separated).
+ *
+ * Usage: annot_rm pdfIN pdfOUT
+ *        annot_rm [options] (-o DIR | -w) [files ...]
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QStringList>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDir>
+#include <QtCore/QSet>
+#include <QtCore/QTime>
+#include <QtCore/QSemaphore>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTextStream>
+#include <QtCore/QtConcurrentMap>
 #include <QtCore/QDebug>
 #include <podofo/podofo.h>
 
+#include <stdio.h>
+#include <stdlib.h>
+
+// PdfMemDocument::Load( file, bForUpdate ) and WriteUpdate came with PoDoFo 0.9.6
+#if defined(PODOFO_VERSION) && PODOFO_VERSION >= PODOFO_MAKE_VERSION(0,9,6)
+#define HAVE_INCREMENTAL_UPDATE
+#endif
+
 using namespace PoDoFo;
-int main( int argc, char **argv ) { 
-  if ( argc != 3 ) {
-    qDebug() << "Wrong number of arguments.";
-    qDebug() << "Usage: "<<argv[0]<<" pdfIN pdfOUT";
-    exit(-1);
+
+/* The options, set before the workers start */
+static QSet<QString> subtypes; // lower case, empty means all
+static QSet<QString> authors;
+static QString outDir; // empty means in place (or the single pdfOUT)
+static QString singleOut;
+static bool incremental = false;
+static int memoryBudget = 512; // MB
+static QSemaphore *memory;
+
+struct fileResult { 
+  QString file;
+  bool ok;
+  QString error;
+  int removed, pages;
+  qint64 sizeIn, sizeOut;
+  int loadMs, editMs, writeMs;
+};
+
+void usage( const char *name ) { 
+  qDebug() << "Usage: "<<name<<" pdfIN pdfOUT";
+  qDebug() << "       "<<name<<" [options] (-o DIR | -w) [files ...]";
+  qDebug() << "  -o DIR     write the results into DIR (under the same names)";
+  qDebug() << "  -w         overwrite the input files";
+  qDebug() << "  -l FILE    read the names of the input files from FILE (one per line, - for stdin)";
+  qDebug() << "  -j N       process N files in parallel (default: the number of cores)";
+  qDebug() << "  -m MB      the memory budget of the files being processed (default: 512)";
+  qDebug() << "  -t TYPE    remove only the annotations of subtype TYPE (e.g. Highlight, can be repeated)";
+  qDebug() << "  -a AUTHOR  remove only the annotations by AUTHOR (can be repeated)";
+  qDebug() << "  -u         write an incremental update instead of rewriting the file";
+  exit(-1);
+}
+
+bool shouldRemove( PdfAnnotation *annot ) { 
+  if ( ! subtypes.isEmpty() ) { 
+    PdfObject *subtype = annot->GetObject()->GetDictionary().GetKey( PdfName::KeySubtype );
+    if ( ! subtype || ! subtype->IsName() ) return false;
+    if ( ! subtypes.contains( QString::fromUtf8( subtype->GetName().GetName().c_str() ).toLower() ) ) return false;
   }
-  PdfMemDocument pdf( argv[1] );
-
-/*  PdfPage *pgA = pdf.GetPage(0);
-  pgA->DeleteAnnotation(0);
-  pdf.Write(argv[2]);
-  return 0; */
-
-  PdfPage *pg;
-  int max;
-  for(int i=0; i< pdf.GetPageCount(); i++ ) {
-    pg = pdf.GetPage(i);
-/*    max=pg->GetNumAnnots();
-    for(int e=0; e<max; e++ ) { 
-      pg->DeleteAnnotation( e );
-    }*/
+  if ( ! authors.isEmpty() ) { 
+    if ( ! annot->GetObject()->GetDictionary().HasKey( "T" ) ) return false;
+    if ( ! authors.contains( QString::fromUtf8( annot->GetTitle().GetStringUtf8().c_str() ) ) ) return false;
+  }
+  return true;
+}
+
+namespace PoDoFo { 
+  uint qHash( const PdfReference &ref ) { 
+    return ref.ObjectNumber()*31+ref.GenerationNumber();
+  }
+}
+
+/* Removes the selected annotations (and the popups belonging to them)
+ * from @pg, returns their number. A broken annotation is skipped, the
+ * rest of the page is processed. */
+int removeAnnotations( PdfPage *pg ) { 
+  QSet<int> remove;
+  QSet<PdfReference> popups;
+  for( int e = 0; e < pg->GetNumAnnots(); e++ ) { 
     try { 
-      while( pg->GetNumAnnots() > 0 ) { 
-	pg->DeleteAnnotation(0);
+      PdfAnnotation *annot = pg->GetAnnotation( e );
+      if ( ! shouldRemove( annot ) ) continue;
+      remove.insert( e );
+      PdfObject *popup = annot->GetObject()->GetDictionary().GetKey( "Popup" );
+      if ( popup && popup->IsReference() ) popups.insert( popup->GetReference() );
+    } catch ( PdfError error ) { 
+      qDebug() << error.what();
+    }
+  }
+  if ( ! popups.isEmpty() ) { 
+    for( int e = 0; e < pg->GetNumAnnots(); e++ ) { 
+      try { 
+        if ( popups.contains( pg->GetAnnotation( e )->GetObject()->Reference() ) ) remove.insert( e );
+      } catch ( PdfError error ) { 
+        qDebug() << error.what();
       }
+    }
+  }
+  // deleting an annotation shifts the indices of the following ones
+  int removed = 0;
+  for( int e = pg->GetNumAnnots()-1; e >= 0; e-- ) { 
+    if ( ! remove.contains( e ) ) continue;
+    try { 
+      pg->DeleteAnnotation( e );
+      removed++;
     } catch ( PdfError error ) { 
       qDebug() << error.what();
     }
   }
-  pdf.Write(argv[2]);
-  return 0;
+  return removed;
 }
 
+/* Writes @pdf over @file, which it was loaded from: the document reads the
+ * objects from the file on demand, so it is written into a temporary file
+ * next to it, which then replaces it */
+bool replaceFile( PdfMemDocument &pdf, const QString &file ) { 
+  QTemporaryFile tmp( QFileInfo( file ).absolutePath()+"/.annot_rmXXXXXX" );
+  if ( ! tmp.open() ) return false;
+  tmp.close();
+  pdf.Write( QFile::encodeName( tmp.fileName() ).data() );
+  if ( rename( QFile::encodeName( tmp.fileName() ).data(), QFile::encodeName( file ).data() ) != 0 ) return false;
+  tmp.setAutoRemove( false ); // it is the file now
+  return true;
+}
+
+fileResult processFile( const QString &file ) { 
+  struct fileResult ret;
+  ret.file = file;
+  ret.ok = false;
+  ret.removed = ret.pages = 0;
+  ret.loadMs = ret.editMs = ret.writeMs = 0;
+  ret.sizeIn = QFileInfo( file ).size();
+  ret.sizeOut = 0;
+  QString out = singleOut;
+  if ( out == "" ) out = ( outDir == "" ) ? file : outDir+"/"+QFileInfo( file ).fileName();
+
+  // a loaded document takes about twice the size of the file
+  int need = qBound( (qint64) 1, 2*ret.sizeIn/(1024*1024)+1, (qint64) memoryBudget );
+  memory->acquire( need );
+  QTime timer;
+  timer.start();
+  try { 
+    PdfMemDocument pdf;
+#ifdef HAVE_INCREMENTAL_UPDATE
+    pdf.Load( QFile::encodeName( file ).data(), incremental );
+#else
+    pdf.Load( QFile::encodeName( file ).data() );
+#endif
+    ret.loadMs = timer.restart();
+    ret.pages = pdf.GetPageCount();
+    for( int i = 0; i < ret.pages; i++ ) ret.removed += removeAnnotations( pdf.GetPage( i ) );
+    ret.editMs = timer.restart();
+    bool inPlace = QFileInfo( out ).absoluteFilePath() == QFileInfo( file ).absoluteFilePath();
+    if ( ret.removed > 0 ) { 
+#ifdef HAVE_INCREMENTAL_UPDATE
+      if ( incremental && inPlace ) pdf.WriteUpdate( QFile::encodeName( out ).data(), false ); // appends, the original content stays where it was
+      else if ( incremental ) pdf.WriteUpdate( QFile::encodeName( out ).data() );
+      else
+#endif
+      if ( inPlace ) { 
+        if ( ! replaceFile( pdf, file ) ) { 
+          memory->release( need );
+          ret.error = "cannot replace "+file;
+          return ret;
+        }
+      } else pdf.Write( QFile::encodeName( out ).data() );
+    } else if ( ! inPlace ) { // nothing to remove, no need to write the document
+      QFile::remove( out );
+      if ( ! QFile::copy( file, out ) ) { 
+        memory->release( need );
+        ret.error = "cannot copy to "+out;
+        return ret;
+      }
+    }
+    ret.writeMs = timer.elapsed();
+    ret.ok = true;
+  } catch ( PdfError error ) { 
+    ret.error = error.what();
+  }
+  memory->release( need );
+  ret.sizeOut = QFileInfo( out ).size();
+  return ret;
+}
 
+int main( int argc, char **argv ) { 
+  QCoreApplication app( argc, argv );
+  QStringList args = app.arguments(), files;
+  bool inPlace = false;
+  args.removeFirst();
+  while( ! args.isEmpty() ) { 
+    QString arg = args.takeFirst();
+    if ( arg.startsWith( "-" ) && arg.size() == 2 && arg != "-" ) { 
+      char opt = arg[1].toAscii();
+      if ( opt == 'w' ) inPlace = true;
+      else if ( opt == 'u' ) incremental = true;
+      else { 
+        if ( args.isEmpty() ) usage( argv[0] );
+        QString val = args.takeFirst();
+        if ( opt == 'o' ) outDir = val;
+        else if ( opt == 'j' ) QThreadPool::globalInstance()->setMaxThreadCount( qMax( 1, val.toInt() ) );
+        else if ( opt == 'm' ) memoryBudget = qMax( 1, val.toInt() );
+        else if ( opt == 't' ) subtypes.insert( val.toLower() );
+        else if ( opt == 'a' ) authors.insert( val );
+        else if ( opt == 'l' ) { 
+          QFile list( val );
+          bool opened;
+          if ( val == "-" ) opened = list.open( stdin, QIODevice::ReadOnly );
+          else opened = list.open( QIODevice::ReadOnly );
+          if ( ! opened ) { 
+            qDebug() << "Cannot read the file list" << val;
+            exit(-1);
+          }
+          QTextStream in( &list );
+          while( ! in.atEnd() ) { 
+            QString line = in.readLine().trimmed();
+            if ( line != "" ) files.append( line );
+          }
+        } else usage( argv[0] );
+      }
+    } else files.append( arg );
+  }
+  if ( outDir == "" && ! inPlace ) { // annot_rm pdfIN pdfOUT
+    if ( files.size() != 2 ) usage( argv[0] );
+    singleOut = files.takeLast();
+  }
+  if ( files.isEmpty() || ( outDir != "" && inPlace ) ) usage( argv[0] );
+  if ( outDir != "" && ! QDir().mkpath( outDir ) ) { 
+    qDebug() << "Cannot create" << outDir;
+    exit(-1);
+  }
+#ifndef HAVE_INCREMENTAL_UPDATE
+  if ( incremental ) { 
+    qDebug() << "Incremental updates need PoDoFo 0.9.6 or newer.";
+    exit(-1);
+  }
+#endif
 
- 
+  memory = new QSemaphore( memoryBudget );
+  QTime timer;
+  timer.start();
+  printf( "# file\tremoved\tpages\tsize in\tsize out\tload [ms]\tedit [ms]\twrite [ms]\tstatus\n" );
+  QFuture<fileResult> results = QtConcurrent::mapped( files, processFile );
+  int failed = 0, removed = 0;
+  qint64 bytes = 0;
+  for( int i = 0; i < files.size(); i++ ) { // in the order of the files, as they are finished
+    struct fileResult res = results.resultAt( i );
+    printf( "%s\t%d\t%d\t%lld\t%lld\t%d\t%d\t%d\t%s\n", QFile::encodeName( res.file ).data(), res.removed, res.pages,
+	    res.sizeIn, res.sizeOut, res.loadMs, res.editMs, res.writeMs, res.ok ? "ok" : res.error.toLocal8Bit().data() );
+    fflush( stdout );
+    if ( ! res.ok ) failed++;
+    removed += res.removed;
+    bytes += res.sizeIn;
+  }
+  int ms = qMax( 1, timer.elapsed() );
+  printf( "# %d files (%d failed), %d annotations removed in %d ms: %.1f files/s, %.1f MB/s\n", files.size(), failed, removed, ms,
+	  1000.0*files.size()/ms, 1000.0*bytes/(1024*1024)/ms );
+  delete memory;
+  return failed ? 1 : 0;
+}
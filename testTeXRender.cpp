@@ -52,6 +52,10 @@ void renderer::updateTeX() {
   r.updateItem( itemID, txt->toPlainText() ); 
 }
 
+void renderer::previewTeX() { 
+  r.previewItem( itemID, txt->toPlainText() );
+}
+
 void renderer::pdfReady( int i ) { 
   qDebug() << "PdfReady...";
   if ( i == itemID ) { 
@@ -70,6 +74,7 @@ int main( int argc, char **argv ) {
   QPushButton *btn = new QPushButton( &mainWin );
   renderer rn( label, textEdit );
   QObject::connect( btn, SIGNAL(clicked()), &rn, SLOT(updateTeX()) );
+  QObject::connect( textEdit, SIGNAL(textChanged()), &rn, SLOT(previewTeX()) );
   mainLayout->addWidget( label );
   mainLayout->addWidget( textEdit );
   mainLayout->addWidget( btn );
@@ -32,6 +32,7 @@ class renderer : public QObject {
 
 	public slots:
 	  void updateTeX();
+	  void previewTeX();
 
 	protected slots:
 	  void pdfReady( int i );
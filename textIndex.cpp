@@ -0,0 +1,206 @@
+/**  This file is part of project comment
+ *
+ *  File: textIndex.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "textIndex.h"
+#include "pageTextLayer.h"
+#include "config.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QDebug>
+
+#include <QtCore/QDir>
+
+#include <string.h>
+#include <sys/types.h>
+#include <utime.h>
+
+const quint32 textIndex::magic = 0x49544d43; // "CMTI"
+const quint32 textIndex::version = 3;
+
+static const qint64 hashedPart = 1 << 20; // the size of the parts of the file hashFile reads
+static const int contentHashAt = 2*sizeof(quint32)+16; // the position of contentHash in the header
+static const int offsetsAt = 3*sizeof(quint32)+32; // the position of the offsets in the header
+
+textIndex::textIndex( const QByteArray &contentHash ):
+	hash( contentHash ), map( NULL ), mapSize( 0 ), nPages( 0 )
+{
+  // the configuration is read here, the other methods may run in a worker thread
+  path = config().cacheDir( "text" )+"/"+QString( hash.toHex() )+".idx";
+  limit = 256;
+  if ( config().haveKey( "text_cache_size" ) && config()["text_cache_size"].toInt() > 0 ) limit = config()["text_cache_size"].toInt();
+  limit *= 1024*1024;
+  file.setFileName( path );
+}
+
+textIndex::~textIndex() { 
+  close();
+}
+
+QByteArray textIndex::hashFile( const QString &fileName ) { 
+  QFile fl( fileName );
+  QFileInfo info( fileName );
+  QCryptographicHash md5( QCryptographicHash::Md5 );
+  if ( ! fl.open( QIODevice::ReadOnly ) ) return QByteArray();
+  md5.addData( QByteArray::number( fl.size() )+" "+QByteArray::number( info.lastModified().toTime_t() )+"\n" );
+  md5.addData( fl.read( hashedPart ) );
+  if ( fl.size() > hashedPart ) { 
+    fl.seek( qMax( hashedPart, fl.size()-hashedPart ) );
+    md5.addData( fl.read( hashedPart ) );
+  }
+  return md5.result();
+}
+
+QByteArray textIndex::hashContents( const QString &fileName ) { 
+  QFile fl( fileName );
+  QCryptographicHash md5( QCryptographicHash::Md5 );
+  if ( ! fl.open( QIODevice::ReadOnly ) ) return QByteArray();
+  while( ! fl.atEnd() ) md5.addData( fl.read( hashedPart ) );
+  return md5.result();
+}
+
+QString textIndex::fileName() const { 
+  return path;
+}
+
+qint64 textIndex::headerSize( int numPages ) const { 
+  return offsetsAt+(numPages+1)*sizeof(quint64);
+}
+
+quint64 textIndex::pageOffset( int page ) const { 
+  quint64 ret;
+  memcpy( &ret, map+offsetsAt+page*sizeof(quint64), sizeof(quint64) );
+  return ret;
+}
+
+bool textIndex::open( int numPages ) { 
+  close();
+  if ( hash.size() != 16 || ! file.exists() ) return false;
+  if ( ! file.open( QIODevice::ReadOnly ) ) return false;
+  mapSize = file.size();
+  if ( mapSize < headerSize( numPages ) || ! (map = file.map( 0, mapSize )) ) { 
+    close();
+    return false;
+  }
+  quint32 mg, ver, np;
+  memcpy( &mg, map, sizeof(quint32) );
+  memcpy( &ver, map+sizeof(quint32), sizeof(quint32) );
+  memcpy( &np, map+contentHashAt+16, sizeof(quint32) );
+  bool ok = ( mg == magic && ver == version && (int) np == numPages && 
+	      memcmp( map+2*sizeof(quint32), hash.constData(), 16 ) == 0 );
+  for( int i = 0; ok && i < numPages; ++i ) { 
+    ok = ( pageOffset( i ) <= pageOffset( i+1 ) );
+  }
+  if ( ok ) ok = ( pageOffset( numPages ) <= (quint64) mapSize );
+  if ( ! ok ) { 
+    qDebug() << "textIndex: Stale text index" << file.fileName();
+    close();
+    return false;
+  }
+  nPages = numPages;
+  utime( QFile::encodeName( path ).constData(), NULL ); // the eviction goes by the modification time
+  return true;
+}
+
+bool textIndex::verify( const QString &docFile ) { 
+  QFile sidecar( path );
+  if ( ! sidecar.open( QIODevice::ReadOnly ) || ! sidecar.seek( contentHashAt ) ) return true; // nothing to check
+  QByteArray stored = sidecar.read( 16 );
+  sidecar.close();
+  QByteArray contents = hashContents( docFile );
+  if ( contents.isEmpty() || stored == contents ) return true;
+  qWarning() << "textIndex: The text index" << path << "does not match" << docFile << ", removing it";
+  QFile::remove( path );
+  return false;
+}
+
+void textIndex::evict() { 
+  QDir cache( QFileInfo( path ).absolutePath() );
+  QFileInfoList entries = cache.entryInfoList( QStringList( "*.idx" ), QDir::Files, QDir::Time ); // newest first
+  qint64 total = 0;
+  foreach( QFileInfo entry, entries ) total += entry.size();
+  for( int i = entries.size()-1; i > 0 && total > limit; --i ) { 
+    if ( entries[i].absoluteFilePath() == QFileInfo( path ).absoluteFilePath() ) continue;
+    total -= entries[i].size();
+    cache.remove( entries[i].fileName() );
+  }
+}
+
+void textIndex::close() { 
+  if ( map ) file.unmap( map );
+  map = NULL;
+  mapSize = 0;
+  nPages = 0;
+  file.close();
+}
+
+pageTextLayer *textIndex::pageLayer( int page ) { 
+  if ( ! map || page < 0 || page >= nPages ) return NULL;
+  quint64 start = pageOffset( page ), end = pageOffset( page+1 );
+  return pageTextLayer::fromIndex( (const char *) map+start, (int) (end-start) );
+}
+
+bool textIndex::save( const QVector<pageTextLayer *> &layers, const QString &docFile ) { 
+  close();
+  if ( hash.size() != 16 ) return false;
+  QByteArray contents = hashContents( docFile );
+  if ( contents.size() != 16 ) return false;
+  QFile tmp( fileName()+".tmp" );
+  if ( ! tmp.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) { 
+    qWarning() << "textIndex: Cannot write" << tmp.fileName();
+    return false;
+  }
+  quint32 np = layers.size();
+  QVector<quint64> offsets;
+  QByteArray blob;
+  quint64 pos = headerSize( np );
+  tmp.write( (const char *) &magic, sizeof(quint32) );
+  tmp.write( (const char *) &version, sizeof(quint32) );
+  tmp.write( hash );
+  tmp.write( contents );
+  tmp.write( (const char *) &np, sizeof(quint32) );
+  tmp.seek( pos );
+  foreach( pageTextLayer *layer, layers ) { 
+    offsets.append( pos );
+    blob = layer->toIndex();
+    tmp.write( blob );
+    pos += blob.size();
+  }
+  offsets.append( pos );
+  tmp.seek( offsetsAt );
+  tmp.write( (const char *) offsets.constData(), offsets.size()*sizeof(quint64) );
+  tmp.close();
+  if ( tmp.error() != QFile::NoError ) { 
+    tmp.remove();
+    return false;
+  }
+  QFile::remove( fileName() );
+  if ( ! tmp.rename( fileName() ) ) return false;
+  evict();
+  return true;
+}
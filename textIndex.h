@@ -0,0 +1,108 @@
+#ifndef _textIndex_H
+#define _textIndex_H
+
+/**  This file is part of comment
+*
+*  File: textIndex.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtCore/QFile>
+
+class pageTextLayer;
+
+/* textIndex --- a sidecar file in the cache directory holding the
+ *               text layers of all pages of a document, so that
+ *               reopening the document does not need poppler to
+ *               extract the text again. The sidecar is named after
+ *               a quick hash of the document (see hashFile) and consists of
+ *
+ *                  quint32 magic, quint32 version, char hash[16], char contentHash[16],
+ *                  quint32 numPages, quint64 offsets[numPages+1],
+ *                  page blobs (see pageTextLayer::toIndex)
+ *
+ *               The page blobs are read directly from the mapped file.
+ *               Since the quick hash does not read the whole document,
+ *               the md5 of the contents is checked in the background
+ *               (see verify) and a sidecar which does not match is
+ *               removed. The sidecars are evicted (the least recently
+ *               used first) when they take more than the text_cache_size
+ *               configuration key (in MB, default 256).
+ */
+class textIndex { 
+	private:
+		static const quint32 magic;
+		static const quint32 version;
+
+		QByteArray hash;
+		QString path;
+		qint64 limit; // the size limit of the cache directory
+		QFile file;
+		uchar *map;
+		qint64 mapSize;
+		int nPages;
+
+		qint64 headerSize( int numPages ) const;
+		quint64 pageOffset( int page ) const;
+		void evict();
+
+	public:
+		textIndex( const QByteArray &contentHash );
+		~textIndex();
+
+		/* Returns the md5 hash of the size, the modification time and
+		 * the first and the last MB of the file fileName (hashing all of
+		 * a large document would cost a good part of what the sidecar saves),
+		 * i.e. the key of the sidecar. It can miss a change in the middle of
+		 * a file which keeps the size and the modification time. */
+		static QByteArray hashFile( const QString &fileName );
+		/* Returns the md5 hash of the contents of the file fileName */
+		static QByteArray hashContents( const QString &fileName );
+
+		QString fileName() const;
+
+		/* Maps the sidecar into memory. Returns false if there
+		 * is no sidecar or if it is stale (wrong version, hash
+		 * or page count, truncated, ...) */
+		bool open( int numPages );
+		void close();
+
+		/* Returns a newly allocated text layer for page @page
+		 * or NULL, if it cannot be read from the sidecar */
+		pageTextLayer *pageLayer( int page );
+
+		/* (Re)writes the sidecar from the text layers of the document
+		 * @docFile (whose contents are hashed) and evicts the old sidecars.
+		 * Only reads the layers, so it may run in a worker thread. */
+		bool save( const QVector<pageTextLayer *> &layers, const QString &docFile );
+
+		/* Checks that the sidecar belongs to the contents of @docFile and
+		 * removes it if it does not. Reads the whole document, so it should
+		 * run in a worker thread. Returns false if the sidecar was stale. */
+		bool verify( const QString &docFile );
+};
+
+
+#endif /* _textIndex_H */
@@ -0,0 +1,158 @@
+/**  This file is part of project comment
+ *
+ *  File: textScan.cpp
+ *  Created: 2026-10-19
+ *  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+ *  License: GPL v2 or later
+ *
+ *  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Library General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this library; see the file COPYING.LIB.  If not, write to
+ *  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ *  Boston, MA 02110-1301, USA.
+ */
+
+
+
+#include "textScan.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && ( defined(__i386__) || defined(__x86_64__) )
+#define TEXTSCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace { 
+
+  typedef int (*scanFunc)( const ushort *, int, const ushort *, int, int );
+
+  inline bool equalAt( const ushort *hay, const ushort *needle, int needleSize ) { 
+    return memcmp( hay, needle, needleSize*sizeof(ushort) ) == 0;
+  }
+
+  int scanScalar( const ushort *hay, int haySize, const ushort *needle, int needleSize, int from ) { 
+    const ushort first = needle[0];
+    const int last = haySize - needleSize;
+    for( int i = from; i <= last; ++i ) { 
+      if ( hay[i] == first && equalAt( hay+i, needle, needleSize ) ) return i;
+    }
+    return -1;
+  }
+
+#ifdef TEXTSCAN_X86
+
+  /* Both SIMD versions compare a block of characters against the first
+   * character of the needle and the block shifted by needleSize-1 against
+   * the last character. movemask yields two bits per 16-bit character,
+   * only the even ones are kept. The tail is left to the scalar version. */
+
+  __attribute__((target("sse2")))
+  int scanSSE2( const ushort *hay, int haySize, const ushort *needle, int needleSize, int from ) { 
+    const __m128i first = _mm_set1_epi16( (short) needle[0] );
+    const __m128i last = _mm_set1_epi16( (short) needle[needleSize-1] );
+    const int lastBlock = haySize - needleSize - 7;
+    int i = from;
+    for( ; i <= lastBlock; i += 8 ) { 
+      __m128i blockF = _mm_loadu_si128( (const __m128i *) (hay+i) );
+      __m128i blockL = _mm_loadu_si128( (const __m128i *) (hay+i+needleSize-1) );
+      __m128i eq = _mm_and_si128( _mm_cmpeq_epi16( blockF, first ), _mm_cmpeq_epi16( blockL, last ) );
+      unsigned int mask = _mm_movemask_epi8( eq ) & 0x5555;
+      while( mask ) { 
+	int bit = __builtin_ctz( mask );
+	if ( equalAt( hay+i+bit/2, needle, needleSize ) ) return i+bit/2;
+	mask &= mask-1;
+      }
+    }
+    return scanScalar( hay, haySize, needle, needleSize, i );
+  }
+
+  __attribute__((target("avx2")))
+  int scanAVX2( const ushort *hay, int haySize, const ushort *needle, int needleSize, int from ) { 
+    const __m256i first = _mm256_set1_epi16( (short) needle[0] );
+    const __m256i last = _mm256_set1_epi16( (short) needle[needleSize-1] );
+    const int lastBlock = haySize - needleSize - 15;
+    int i = from;
+    for( ; i <= lastBlock; i += 16 ) { 
+      __m256i blockF = _mm256_loadu_si256( (const __m256i *) (hay+i) );
+      __m256i blockL = _mm256_loadu_si256( (const __m256i *) (hay+i+needleSize-1) );
+      __m256i eq = _mm256_and_si256( _mm256_cmpeq_epi16( blockF, first ), _mm256_cmpeq_epi16( blockL, last ) );
+      unsigned int mask = ( (unsigned int) _mm256_movemask_epi8( eq ) ) & 0x55555555u;
+      while( mask ) { 
+	int bit = __builtin_ctz( mask );
+	if ( equalAt( hay+i+bit/2, needle, needleSize ) ) return i+bit/2;
+	mask &= mask-1;
+      }
+    }
+    return scanScalar( hay, haySize, needle, needleSize, i );
+  }
+
+#endif
+
+  scanFunc bestScan( const char **name ) { 
+#ifdef TEXTSCAN_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports( "avx2" ) ) { 
+      *name = "avx2";
+      return scanAVX2;
+    }
+    if ( __builtin_cpu_supports( "sse2" ) ) { 
+      *name = "sse2";
+      return scanSSE2;
+    }
+#endif
+    *name = "scalar";
+    return scanScalar;
+  }
+
+  const char *scanName = NULL;
+  scanFunc scan = bestScan( &scanName );
+}
+
+int textScan::indexOf( const ushort *hay, int haySize, const ushort *needle, int needleSize, int from ) { 
+  if ( from < 0 ) from = 0;
+  if ( needleSize <= 0 ) return ( from <= haySize ) ? from : -1;
+  if ( haySize - from < needleSize ) return -1;
+  return scan( hay, haySize, needle, needleSize, from );
+}
+
+int textScan::indexOf( const QString &hay, const QString &needle, int from ) { 
+  return indexOf( hay.utf16(), hay.size(), needle.utf16(), needle.size(), from );
+}
+
+bool textScan::setImplementation( const char *name ) { 
+  if ( strcmp( name, "scalar" ) == 0 ) { 
+    scan = scanScalar;
+    scanName = "scalar";
+    return true;
+  }
+#ifdef TEXTSCAN_X86
+  __builtin_cpu_init();
+  if ( strcmp( name, "sse2" ) == 0 && __builtin_cpu_supports( "sse2" ) ) { 
+    scan = scanSSE2;
+    scanName = "sse2";
+    return true;
+  }
+  if ( strcmp( name, "avx2" ) == 0 && __builtin_cpu_supports( "avx2" ) ) { 
+    scan = scanAVX2;
+    scanName = "avx2";
+    return true;
+  }
+#endif
+  return false;
+}
+
+const char *textScan::implementation() { 
+  return scanName;
+}
@@ -0,0 +1,55 @@
+#ifndef _textScan_H
+#define _textScan_H
+
+/**  This file is part of comment
+*
+*  File: textScan.h
+*  Created: 19. 10. 2026
+*  Author: Jonathan Verner <jonathan.verner@matfyz.cz>
+*  License: GPL v2 or later
+*
+*  Copyright (C) 2010 Jonathan Verner <jonathan.verner@matfyz.cz>
+*
+*  This library is free software; you can redistribute it and/or
+*  modify it under the terms of the GNU Library General Public
+*  License as published by the Free Software Foundation; either
+*  version 2 of the License, or (at your option) any later version.
+*
+*  This library is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+*  Library General Public License for more details.
+*
+*  You should have received a copy of the GNU Library General Public License
+*  along with this library; see the file COPYING.LIB.  If not, write to
+*  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+*  Boston, MA 02110-1301, USA.
+*/
+
+#include <QtCore/QString>
+
+/* textScan --- substring search over UTF-16 text. On x86 it filters
+ *              candidate positions by comparing the first and last
+ *              character of the needle against 8 (SSE2) or 16 (AVX2)
+ *              characters at once and verifies candidates with
+ *              memcmp. The implementation is chosen at runtime
+ *              according to the cpu, with a scalar fallback.
+ */
+namespace textScan { 
+
+  /* Returns the position of the first occurence of @needle
+   * in @hay at or after @from, or -1 if there is none */
+  int indexOf( const ushort *hay, int haySize, const ushort *needle, int needleSize, int from = 0 );
+  int indexOf( const QString &hay, const QString &needle, int from = 0 );
+
+  /* Forces a particular implementation ("avx2", "sse2" or "scalar"),
+   * returns false if it is not available on this cpu. Only
+   * meant for benchmarks and testing. */
+  bool setImplementation( const char *name );
+
+  /* Returns the name of the implementation in use */
+  const char *implementation();
+};
+
+
+#endif /* _textScan_H */
@@ -42,7 +42,7 @@
 QIcon textTool::icon;
 
 bool textTool::acceptEventsFor( QGraphicsItem *item ) {
-  if ( dynamic_cast<textAnnotation*>(item) ) {
+  if ( qgraphicsitem_cast<textAnnotation*>(item) ) {
     return true;
   }
   return false;
@@ -37,6 +37,9 @@ class textTool : public abstractTool {
 
 class textAnnotation : public abstractAnnotation { 
 	public:
+		enum { Type = textAnnotationType };
+		int type() const { return Type; };
+
 		textAnnotation( textTool *tool, PoDoFo::PdfAnnotation *textAnnot = NULL, pdfCoords *transform = NULL );
 		static bool isA( PoDoFo::PdfAnnotation *annotation );
 		virtual void saveToPdfPage( PoDoFo::PdfDocument *document, PoDoFo::PdfPage *pg, pdfCoords *coords );